@@ -2,7 +2,17 @@
 #define _ASYNC_LOGGER_HPP_
 
 #include <unistd.h>
+#include <cstdint>
+#include <stdexcept>
+#include <BinaryFormat.hpp>
+#include <CrashHandler.hpp>
+#include <Executor.hpp>
+#include <FlushPolicy.hpp>
 #include <Logger.hpp>
+#include <LoggerOptions.hpp>
+#include <TextFormat.hpp>
+#include <ThreadOptions.hpp>
+#include <WaitPolicy.hpp>
 
 namespace common {
 namespace logger {
@@ -12,54 +22,334 @@ struct MessageInfo {
     char end;
     bool isTimed;
     bool hasTime;
+    std::uint8_t level;    // label::severity of its labels, 0 without.
     // bool isRaw = !isTimed;
 };
 
+class Message;
+
+// What the consumer can do with a message of one type. One row per instantiated message type, see MessageType.
+struct MessageOps {
+    void (*write)(const Message *, text::Writer &);
+    void (*encode)(const Message *, binary::Encoder &, const timestamp::MicroSecondTime *);
+    const timestamp::Time *(*getTime)(const Message *);
+    timestamp::MicroSecondTime (*getMicroSecondTime)(const Message *);
+    char delim;
+    char end;
+    std::uint8_t level;
+};
+
+// Filled during static initialization, read only afterwards. Zero initialized, so it is there before any type registers.
+template <typename = void>
+struct MessageTable {
+    static constexpr std::size_t maxTypes = 4096;
+    static MessageOps ops[maxTypes];
+    static std::size_t count;
+
+    static std::uint16_t add(const MessageOps &row) {
+        if (count == maxTypes) {
+            throw std::length_error{"Too many message types"};
+        }
+        ops[count] = row;
+        return static_cast<std::uint16_t>(count++);
+    }
+};
+
+template <typename T>
+MessageOps MessageTable<T>::ops[MessageTable<T>::maxTypes];
+template <typename T>
+std::size_t MessageTable<T>::count = 0;
+
+// No vtable, a message starts with its type id and flags. Everything else goes through the table.
 class Message {
    public:
-    virtual void write(std::ostream &os) const = 0;
-    virtual MessageInfo getInfo() const = 0;
-    virtual const timestamp::Time *getTime() const { return nullptr; };    // This never should be called.
+    enum Flags : std::uint8_t { Timed = 1, HasTime = 2 };
+
+    // Type id and flags of the most derived message, passed down to the constructor of Message.
+    struct Header {
+        std::uint16_t type;
+        std::uint8_t flags;
+    };
+
+   private:
+    Header header;
+
+   protected:
+    explicit Message(Header header_) : header(header_) {}
+
+   public:
+    void write(text::Writer &out) const { MessageTable<>::ops[this->header.type].write(this, out); }
+    // Binary sink instead of write(). prefix is the consumer's time, for timed messages without one of their own.
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const { MessageTable<>::ops[this->header.type].encode(this, enc, prefix); }
+    MessageInfo getInfo() const {
+        const auto &row = MessageTable<>::ops[this->header.type];
+        return MessageInfo{row.delim, row.end, (this->header.flags & Timed) != 0, (this->header.flags & HasTime) != 0, row.level};
+    }
+    const timestamp::Time *getTime() const { return MessageTable<>::ops[this->header.type].getTime(this); }    // Only when getInfo().hasTime.
+    // Whatever the time type, converted. Only when getInfo().hasTime.
+    timestamp::MicroSecondTime getMicroSecondTime() const { return MessageTable<>::ops[this->header.type].getMicroSecondTime(this); }
+};
+
+// Registers M in MessageTable. M provides write(), encode() and, with HasTime in M::flags, time().
+template <typename M>
+struct MessageType {
+   private:
+    // Whatever a message owns goes once it is written, by either of them. Leaked in a crash drain, free() may be what crashed.
+    static void release(const Message *msg, std::true_type) {
+        if (!crash::draining()) {
+            static_cast<const M *>(msg)->release();
+        }
+    }
+    static void release(const Message *msg, std::false_type) {}
+
+    static void write(const Message *msg, text::Writer &out) {
+        static_cast<const M *>(msg)->write(out);
+        release(msg, std::integral_constant<bool, M::owning>{});
+    }
+    static void encode(const Message *msg, binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) {
+        static_cast<const M *>(msg)->encode(enc, prefix);
+        release(msg, std::integral_constant<bool, M::owning>{});
+    }
+    static const timestamp::Time *getTime(const Message *msg, std::true_type) { return static_cast<const M *>(msg)->time(); }
+    static const timestamp::Time *getTime(const Message *msg, std::false_type) { return nullptr; }
+    static const timestamp::Time *getTime(const Message *msg) { return getTime(msg, std::integral_constant<bool, (M::flags & Message::HasTime) != 0>{}); }
+    static timestamp::MicroSecondTime getMicroSecondTime(const Message *msg, std::true_type) {
+        return timestamp::toMicroSecondTime(*static_cast<const M *>(msg)->time());
+    }
+    static timestamp::MicroSecondTime getMicroSecondTime(const Message *msg, std::false_type) { return timestamp::MicroSecondTime{0L}; }
+    static timestamp::MicroSecondTime getMicroSecondTime(const Message *msg) {
+        return getMicroSecondTime(msg, std::integral_constant<bool, (M::flags & Message::HasTime) != 0>{});
+    }
+
+   public:
+    static const std::uint16_t id;
+
+    static Message::Header header() { return Message::Header{id, M::flags}; }
+};
+
+template <typename M>
+const std::uint16_t MessageType<M>::id = MessageTable<>::add(MessageOps{&MessageType<M>::write, &MessageType<M>::encode, &MessageType<M>::getTime,
+                                                                            &MessageType<M>::getMicroSecondTime, M::delimiter, M::terminator, M::severity});
+
+// A string argument as msgtool passes it on to the message: T as it was logged, capacity what fits in the message, limit what is kept
+// of it in all. See CapturedString.
+template <typename T, std::size_t capacity, std::size_t limit>
+struct Captured {};
+
+// How a message keeps an argument of type A, and what its constructor takes for it.
+template <typename A>
+struct argtraits {
+    using stored = typename std::decay<A>::type;
+    using param = A &&;
+};
+
+// Only a std::string&& can be moved in, and only when there is room for a std::string. It is moved whole, nothing spills.
+template <typename T, std::size_t capacity, std::size_t limit>
+struct argtraits<Captured<T, capacity, limit>> {
+    static constexpr bool movable =
+        !std::is_lvalue_reference<T>::value && std::is_same<typename std::decay<T>::type, std::string>::value && capacity >= sizeof(std::string);
+    using stored = CapturedString<capacity, movable, movable ? capacity : limit>;
+    using param = T &&;
+};
+
+template <typename T>
+struct is_owning : std::false_type {};
+template <std::size_t capacity>
+struct is_owning<CapturedString<capacity, true>> : std::true_type {};
+
+template <typename... Args>
+struct owningOf : std::false_type {};
+template <typename T, typename... Args>
+struct owningOf<T, Args...> : std::integral_constant<bool, is_owning<T>::value || owningOf<Args...>::value> {};
+
+template <std::size_t idx, std::size_t size, typename Tuple>
+struct tuplereleaser {
+    template <typename T>
+    static void release(const T &value) {}
+    template <std::size_t capacity>
+    static void release(const CapturedString<capacity, true> &value) {
+        value.release();
+    }
+    static void release(const Tuple &t) {
+        release(std::get<idx>(t));
+        tuplereleaser<idx + 1, size, Tuple>::release(t);
+    }
+};
+
+template <std::size_t size, typename Tuple>
+struct tuplereleaser<size, size, Tuple> {
+    static void release(const Tuple &t) {}
+};
+
+// A slot after a message holding bytes one of its strings spilled, see CapturedString. Written by that message, nothing of its own.
+// size: the queue's msgSize().
+template <std::size_t size>
+class Continuation : public Message {
+   private:
+    // The chunk right after the header, aligned, and its bytes after it.
+    static constexpr std::size_t align = alignof(SpillChunk);
+    static constexpr std::size_t used = (sizeof(Message) + align - 1) / align * align + sizeof(SpillChunk);
+
+    SpillChunk chunk;
+    char bytes[size / align * align - used];
+
+   public:
+    static constexpr std::uint8_t flags = 0;
+    static constexpr std::uint8_t severity = 0;
+    static constexpr char delimiter = LoggerDefaults::defaultDelim;
+    static constexpr char terminator = LoggerDefaults::defaultEnd;
+    static constexpr bool owning = false;
+    static constexpr std::size_t room = sizeof(bytes);
+
+    Continuation(const char *bytes_, std::size_t length) : Message{MessageType<Continuation>::header()}, chunk{nullptr, static_cast<std::uint32_t>(length)} {
+        static_assert(sizeof(Continuation) <= size, "Continuation larger than a slot");
+        std::memcpy(this->bytes, bytes_, length);
+    }
+
+    SpillChunk *get() { return &this->chunk; }
+
+    void write(text::Writer &out) const {}
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const {}
+};
+
+// Queue bytes all the strings of one log call may spill into, the queue's spillRoom() in whole Continuations. So that a record always fits.
+template <typename Q>
+std::size_t spillBudget(const Q &queue) {
+    constexpr std::size_t slot = Q::template requiredSize<std::tuple<Continuation<Q::msgSize()>>>();
+    return queue.spillRoom() / slot * slot;
+}
+
+// Spilled bytes of a message's strings go to Continuations at offset and on, right after it. Returns the queue bytes they took.
+// spilled: taken so far by the log call, what is over spillBudget() is cut.
+template <std::size_t idx, std::size_t size, typename Tuple>
+struct tuplespiller {
+    template <typename Q, typename T>
+    static std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled, T &value) {
+        return 0;
+    }
+    template <typename Q, std::size_t capacity, std::size_t limit>
+    static std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled, CapturedString<capacity, false, limit> &value) {
+        if (!CapturedString<capacity, false, limit>::spills || __builtin_expect(value.spilled() == 0, 1)) {
+            return 0;
+        }
+        return spillChunks(queue, offset, spilled, value);
+    }
+    template <typename Q, std::size_t capacity, std::size_t limit>
+    __attribute__((noinline)) static std::size_t spillChunks(Q &queue, std::size_t offset, std::size_t spilled, CapturedString<capacity, false, limit> &value) {
+        using chunk_t = Continuation<Q::msgSize()>;
+        constexpr std::size_t slot = Q::template requiredSize<std::tuple<chunk_t>>();
+        const std::size_t budget = spillBudget(queue);
+        const std::size_t chunks = budget > spilled ? (budget - spilled) / slot : 0;
+        const char *rest = value.rest();
+        std::size_t left = value.spilled();
+        if (left > chunks * chunk_t::room) {
+            left = chunks * chunk_t::room;
+            value.cut(left);
+        }
+        value.spill(nullptr);
+        SpillChunk *last = nullptr;
+        std::size_t taken = 0;
+        while (left > 0) {
+            const std::size_t length = left < chunk_t::room ? left : chunk_t::room;
+            SpillChunk *chunk = queue.template doOffsetEmplace<chunk_t>(offset + taken, rest, length)->get();
+            if (last) {
+                last->next = chunk;
+            } else {
+                value.spill(chunk);
+            }
+            last = chunk;
+            rest += length;
+            left -= length;
+            taken += slot;
+        }
+        return taken;
+    }
+    template <typename Q>
+    static std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled, Tuple &t) {
+        const std::size_t taken = spill(queue, offset, spilled, std::get<idx>(t));
+        return taken + tuplespiller<idx + 1, size, Tuple>::spill(queue, offset + taken, spilled + taken, t);
+    }
 };
 
-template <std::size_t idx, std::size_t size, char delim, typename Tuple>
+template <std::size_t size, typename Tuple>
+struct tuplespiller<size, size, Tuple> {
+    template <typename Q>
+    static std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled, Tuple &t) {
+        return 0;
+    }
+};
+
+// checked: whether each field reserves room for itself, only needed when the whole message has no bound.
+template <std::size_t idx, std::size_t size, char delim, typename Tuple, bool checked>
 struct tuplewriter {
-    static void write(std::ostream &os, const Tuple &t) {
-        os << std::get<idx>(t);
+    __attribute__((always_inline)) static void write(text::Writer &out, const Tuple &t) {
+        out.write<checked>(std::get<idx>(t));
         if (idx != size - 1) {
-            os << delim;
+            out.write<checked>(delim);
         }
-        tuplewriter<idx + 1, size, delim, Tuple>::write(os, t);
+        tuplewriter<idx + 1, size, delim, Tuple, checked>::write(out, t);
     }
 };
 
-template <std::size_t size, char delim, typename Tuple>
-struct tuplewriter<size, size, delim, Tuple> {
-    static void write(std::ostream &os, const Tuple &t) {}
+template <std::size_t size, char delim, typename Tuple, bool checked>
+struct tuplewriter<size, size, delim, Tuple, checked> {
+    static void write(text::Writer &out, const Tuple &t) {}
 };
 
 // Stores Args... to tuple
 // write(): eg. Args as a1,a2,a3  written to file as a1<delim>a2<delim>a3<end>
 template <char delim, char end, typename... Args>
 class FormattedMessage : public Message {
-   private:
+   protected:
     // Something.
-    using data_t = std::tuple<typename std::decay<Args>::type...>;
+    using data_t = std::tuple<typename argtraits<Args>::stored...>;
     data_t data;
 
+    // For the derived messages, which have types of their own.
+    __attribute__((always_inline)) FormattedMessage(Header header_, typename argtraits<Args>::param... args)
+        : Message{header_}, data{std::forward<typename argtraits<Args>::param>(args)...} {}
+
+    using fieldlength = text::maxLengthOf<typename argtraits<Args>::stored...>;
+
+    template <bool checked>
+    __attribute__((always_inline)) void writeFields(text::Writer &out) const {
+        tuplewriter<0, sizeof...(Args), delim, data_t, checked>::write(out, this->data);
+        out.write<checked>(end);
+    }
+
    public:
-    __attribute__((always_inline)) FormattedMessage(Args &&... args) : data{std::forward<Args>(args)...} {
+    static constexpr std::uint8_t flags = 0;
+    static constexpr std::uint8_t severity = 0;
+    static constexpr char delimiter = delim;
+    static constexpr char terminator = end;
+    static constexpr bool owning = owningOf<typename argtraits<Args>::stored...>::value;
+
+    __attribute__((always_inline)) FormattedMessage(typename argtraits<Args>::param... args)
+        : Message{MessageType<FormattedMessage>::header()}, data{std::forward<typename argtraits<Args>::param>(args)...} {
         // Do nothing else.
     }
 
     using argtuple = std::tuple<Args...>;
 
-    void write(std::ostream &os) const override {
-        tuplewriter<0, sizeof...(Args), delim, decltype(this->data)>::write(os, this->data);
-        os << end;
+    // Longest text of the message, 0 if unbounded. Bounded ones check for room once, instead of per field.
+    static constexpr std::size_t maxLength = fieldlength::bounded ? fieldlength::value + sizeof...(Args) + 1 : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        this->writeFields<maxLength == 0>(out);
     }
 
-    MessageInfo getInfo() const override { return MessageInfo{delim, end, false, false}; }
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const {
+        enc.record<binary::Layout<delim, stringct::StringCT<>, stringct::StringCT<end>, void, typename argtraits<Args>::stored...>>(prefix, this->data);
+    }
+
+    void release() const { tuplereleaser<0, sizeof...(Args), data_t>::release(this->data); }
+
+    // Producer, right after construction. See tuplespiller.
+    template <typename Q>
+    __attribute__((always_inline)) std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled) {
+        return tuplespiller<0, sizeof...(Args), data_t>::spill(queue, offset, spilled, this->data);
+    }
 };
 
 // Might end up making this a composition later if the need arises.
@@ -75,16 +365,25 @@ class TimedFormattedMessage : public TimedFormattedMessage<delim, end, labellist
     time_t tm;
 
    public:
-    __attribute__((always_inline)) TimedFormattedMessage(T &&tm_, Args &&... args) : parent{std::forward<Args>(args)...}, tm{std::forward<T>(tm_)} {}
+    static constexpr std::uint8_t flags = Message::Timed | Message::HasTime;
+
+    __attribute__((always_inline)) TimedFormattedMessage(T &&tm_, typename argtraits<Args>::param... args)
+        : parent{MessageType<TimedFormattedMessage>::header(), std::forward<typename argtraits<Args>::param>(args)...}, tm{std::forward<T>(tm_)} {}
     using argtuple = std::tuple<T, Args...>;
 
-    void write(std::ostream &os) const override {
-        os << this->tm;
-        this->parent::write(os);
+    static constexpr std::size_t maxLength = parent::maxLength != 0 ? text::codec<time_t>::maxLength + parent::maxLength : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        out.write<maxLength == 0>(this->tm);
+        this->parent::template writeFields<maxLength == 0>(out);
     }
 
-    MessageInfo getInfo() const override { return MessageInfo{delim, end, true, true}; }
-    const timestamp::Time *getTime() const override { return &this->tm; }
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const {
+        enc.record<typename parent::template layout<time_t>>(prefix, this->tm, this->data);
+    }
+
+    const time_t *time() const { return &this->tm; }
 };
 
 template <char delim, char end, typename labellist, typename... Args>
@@ -92,38 +391,219 @@ class TimedFormattedMessage<delim, end, labellist, void, Args...> : public Forma
    protected:
     using parent = FormattedMessage<delim, end, Args...>;
 
+    using labelstringct = typename stringct::ConcatStringCT<stringct::StringCT<delim>, typename labellist::template makestr<delim>::type,
+                                                            stringct::StringCT<(sizeof...(Args) == 0 ? end : delim)>>::type;
+
+    template <bool checked>
+    __attribute__((always_inline)) void writeFields(text::Writer &out) const {
+        out.reserve(checked ? sizeof(labelstringct::str) : 0);
+        out.append(labelstringct::str, sizeof(labelstringct::str) - 1);
+        if (sizeof...(Args) > 0) {
+            this->parent::template writeFields<checked>(out);
+        }
+    }
+
+    template <typename Time>
+    using layout = binary::Layout<delim, labelstringct, typename std::conditional<(sizeof...(Args) > 0), stringct::StringCT<end>, stringct::StringCT<>>::type,
+                                  Time, typename argtraits<Args>::stored...>;
+
+    __attribute__((always_inline)) TimedFormattedMessage(Message::Header header_, typename argtraits<Args>::param... args)
+        : parent(header_, std::forward<typename argtraits<Args>::param>(args)...) {}
+
    public:
-    __attribute__((always_inline)) TimedFormattedMessage(Args &&... args) : parent(std::forward<Args>(args)...) {}
+    static constexpr std::uint8_t flags = Message::Timed;
+    static constexpr std::uint8_t severity = label::severity<labellist>::value;
+
+    __attribute__((always_inline)) TimedFormattedMessage(typename argtraits<Args>::param... args)
+        : parent(MessageType<TimedFormattedMessage>::header(), std::forward<typename argtraits<Args>::param>(args)...) {}
     using argtuple = std::tuple<Args...>;
-    void write(std::ostream &os) const override {
-        using labelstringct = typename stringct::ConcatStringCT<stringct::StringCT<delim>, typename labellist::template makestr<delim>::type,
-                                                                stringct::StringCT<(sizeof...(Args) == 0 ? end : delim)>>::type;
-        os << labelstringct::str;
-        if (sizeof...(Args) > 0) {
-            this->parent::write(os);
+
+    static constexpr std::size_t maxLength = parent::fieldlength::bounded ? sizeof(labelstringct::str) + parent::maxLength : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        this->writeFields<maxLength == 0>(out);
+    }
+
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const { enc.record<layout<void>>(prefix, this->data); }
+};
+
+// Each field followed by the literal after its placeholder, first the placeholder of the first field.
+template <std::size_t idx, std::size_t size, typename format, std::size_t first, typename Tuple, bool checked>
+struct formatwriter {
+    __attribute__((always_inline)) static void write(text::Writer &out, const Tuple &t) {
+        using literal = typename format::template segment<first + idx + 1>;
+        out.write<checked>(std::get<idx>(t));
+        out.reserve(checked ? sizeof(literal::str) : 0);
+        out.append(literal::str, sizeof(literal::str) - 1);
+        formatwriter<idx + 1, size, format, first, Tuple, checked>::write(out, t);
+    }
+};
+
+template <std::size_t size, typename format, std::size_t first, typename Tuple, bool checked>
+struct formatwriter<size, size, format, first, Tuple, checked> {
+    static void write(text::Writer &out, const Tuple &t) {}
+};
+
+// binary::BasicLayout separators of the same.
+template <typename format, std::size_t first>
+struct FormatSeparators {
+    template <std::size_t idx, std::size_t size>
+    struct separator : format::template segment<first + idx + 1> {};
+};
+
+// Fields of a message logged through a format (see label::Formatted), which may be split over several like FormattedMessage.
+// first: the placeholder Args start at. Only literals go between fields, the one filling the last placeholder also ends the line.
+template <char delim, char end, typename format, std::size_t first, typename... Args>
+class FormatMessage : public Message {
+   protected:
+    using data_t = std::tuple<typename argtraits<Args>::stored...>;
+    data_t data;
+
+    static constexpr bool last = first + sizeof...(Args) == format::placeholders;
+
+    __attribute__((always_inline)) FormatMessage(Header header_, typename argtraits<Args>::param... args)
+        : Message{header_}, data{std::forward<typename argtraits<Args>::param>(args)...} {}
+
+    using fieldlength = text::maxLengthOf<typename argtraits<Args>::stored...>;
+
+    template <bool checked>
+    __attribute__((always_inline)) void writeFields(text::Writer &out) const {
+        formatwriter<0, sizeof...(Args), format, first, data_t, checked>::write(out, this->data);
+        if (last) {
+            out.write<checked>(end);
         }
     }
 
-    MessageInfo getInfo() const override { return MessageInfo{delim, end, true, false}; }
+    template <typename prefix, typename Time>
+    using layout = binary::BasicLayout<prefix, FormatSeparators<format, first>, typename std::conditional<last, stringct::StringCT<end>, stringct::StringCT<>>::type,
+                                       Time, typename argtraits<Args>::stored...>;
+
+   public:
+    static constexpr std::uint8_t flags = 0;
+    static constexpr std::uint8_t severity = 0;
+    static constexpr char delimiter = delim;
+    static constexpr char terminator = end;
+    static constexpr bool owning = owningOf<typename argtraits<Args>::stored...>::value;
+
+    __attribute__((always_inline)) FormatMessage(typename argtraits<Args>::param... args)
+        : Message{MessageType<FormatMessage>::header()}, data{std::forward<typename argtraits<Args>::param>(args)...} {}
+
+    using argtuple = std::tuple<Args...>;
+
+    static constexpr std::size_t maxLength = fieldlength::bounded ? fieldlength::value + format::length(first + 1, first + sizeof...(Args) + 1) + 1 : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        this->writeFields<maxLength == 0>(out);
+    }
+
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const { enc.record<layout<stringct::StringCT<>, void>>(prefix, this->data); }
+
+    void release() const { tuplereleaser<0, sizeof...(Args), data_t>::release(this->data); }
+
+    // Producer, right after construction. See tuplespiller.
+    template <typename Q>
+    __attribute__((always_inline)) std::size_t spill(Q &queue, std::size_t offset, std::size_t spilled) {
+        return tuplespiller<0, sizeof...(Args), data_t>::spill(queue, offset, spilled, this->data);
+    }
+};
+
+// TimedFormattedMessage for a format: time, labels delimited, then the literal before the first placeholder and on as FormatMessage.
+template <char delim, char end, typename labellist, typename T, typename... Args>
+class TimedFormatMessage : public TimedFormatMessage<delim, end, labellist, void, Args...> {
+   private:
+    static_assert(timestamp::is_time<T>::value, "Time should be here.");
+
+    using parent = TimedFormatMessage<delim, end, labellist, void, Args...>;
+    using time_t = typename std::decay<T>::type;
+    time_t tm;
+
+   public:
+    static constexpr std::uint8_t flags = Message::Timed | Message::HasTime;
+
+    __attribute__((always_inline)) TimedFormatMessage(T &&tm_, typename argtraits<Args>::param... args)
+        : parent{MessageType<TimedFormatMessage>::header(), std::forward<typename argtraits<Args>::param>(args)...}, tm{std::forward<T>(tm_)} {}
+    using argtuple = std::tuple<T, Args...>;
+
+    static constexpr std::size_t maxLength = parent::maxLength != 0 ? text::codec<time_t>::maxLength + parent::maxLength : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        out.write<maxLength == 0>(this->tm);
+        this->parent::template writeFields<maxLength == 0>(out);
+    }
+
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const {
+        enc.record<typename parent::template layout<time_t>>(prefix, this->tm, this->data);
+    }
+
+    const time_t *time() const { return &this->tm; }
 };
 
-template <std::size_t msgsize, std::size_t size>
-class FixedMessageLFQ : public container::LockFreeQueue<size> {
+template <char delim, char end, typename labellist, typename... Args>
+class TimedFormatMessage<delim, end, labellist, void, Args...> : public FormatMessage<delim, end, typename labellist::formatct, 0, Args...> {
+   protected:
+    using parent = FormatMessage<delim, end, typename labellist::formatct, 0, Args...>;
+
+    using labelstringct = typename stringct::ConcatStringCT<stringct::StringCT<delim>, typename labellist::template makestr<delim>::type,
+                                                            stringct::StringCT<delim>, typename labellist::formatct::template segment<0>>::type;
+
+    template <bool checked>
+    __attribute__((always_inline)) void writeFields(text::Writer &out) const {
+        out.reserve(checked ? sizeof(labelstringct::str) : 0);
+        out.append(labelstringct::str, sizeof(labelstringct::str) - 1);
+        this->parent::template writeFields<checked>(out);
+    }
+
+    template <typename Time>
+    using layout = typename parent::template layout<labelstringct, Time>;
+
+    __attribute__((always_inline)) TimedFormatMessage(Message::Header header_, typename argtraits<Args>::param... args)
+        : parent(header_, std::forward<typename argtraits<Args>::param>(args)...) {}
+
+   public:
+    static constexpr std::uint8_t flags = Message::Timed;
+    static constexpr std::uint8_t severity = label::severity<labellist>::value;
+
+    __attribute__((always_inline)) TimedFormatMessage(typename argtraits<Args>::param... args)
+        : parent(MessageType<TimedFormatMessage>::header(), std::forward<typename argtraits<Args>::param>(args)...) {}
+    using argtuple = std::tuple<Args...>;
+
+    static constexpr std::size_t maxLength = parent::fieldlength::bounded ? sizeof(labelstringct::str) + parent::maxLength : 0;
+
+    void write(text::Writer &out) const {
+        out.reserve(maxLength);
+        this->writeFields<maxLength == 0>(out);
+    }
+
+    void encode(binary::Encoder &enc, const timestamp::MicroSecondTime *prefix) const { enc.record<layout<void>>(prefix, this->data); }
+};
+
+template <std::size_t msgsize, std::size_t size, typename StoragePolicy = container::storage::Inline>
+class FixedMessageLFQ : public container::LockFreeQueue<size, StoragePolicy> {
     static_assert((msgsize & (msgsize - 1)) == 0, "msgsize should be power of 2");
     static_assert((size & (size - 1)) == 0, "size should be power of 2");
 
    protected:
-    using parent = container::LockFreeQueue<size>;
+    using parent = container::LockFreeQueue<size, StoragePolicy>;
 
    public:
+    // size = container::dynamicSize takes the capacity in bytes here instead.
+    explicit FixedMessageLFQ(std::size_t capacity_ = size) : parent{capacity_} {
+        if (this->capacity() < 2 * msgsize) {
+            throw std::invalid_argument{"Queue capacity should hold more than one msg"};
+        }
+    }
+
     // Can effectively store one msg less than total.
-    static constexpr std::size_t maxSize() noexcept { return size - msgsize; };
+    std::size_t maxSize() const noexcept { return this->capacity() - msgsize; };
 
     const Message *front(int offset = 0) const { return static_cast<const Message *>(this->parent::front(offset)); }
 
     static constexpr std::size_t msgSize() noexcept { return msgsize; }
 
-    void pop() { this->container::LockFreeQueue<size>::pop(msgsize); }
+    void pop() { this->parent::pop(msgsize); }
 
     template <typename T, typename... Args>
     __attribute__((always_inline)) void emplace(Args &&... args) {
@@ -138,10 +618,160 @@ class FixedMessageLFQ : public container::LockFreeQueue<size> {
         this->updateTail(msgsize);
     }
 
-    __attribute__((always_inline)) inline bool canEnqueue(std::size_t requiredSize) const {
+    // Bytes taken by a split message, i.e. the tuple of chunks made by msgtool.
+    template <typename MsgList>
+    static constexpr std::size_t requiredSize() noexcept {
+        return std::tuple_size<MsgList>::value * msgsize;
+    }
+
+    // Moves the private tail only. Used when the commit is left to a BatchProducer.
+    __attribute__((always_inline)) void advance(std::size_t elemsize) { this->advanceTail(elemsize); }
+
+    // Bytes the long strings of one log call may spill into, see spillBudget().
+    std::size_t spillRoom() const noexcept { return this->capacity() / 2; }
+
+    __attribute__((always_inline)) inline bool canEnqueue(std::size_t requiredSize) {
         // Don't do subtraction! std::size_t
-        return __builtin_expect(this->fillSize() + requiredSize < maxSize(), 1);
+        // fill + requiredSize < maxSize()
+        return this->reserve(requiredSize + msgsize);
+    }
+};
+
+// Every message is stored as a record: RecordHeader followed by the message, taking exactly its (aligned) sizeof.
+// A record never wraps. If it doesn't fit before the end of the buffer, a skip marker is left there and it goes to the front.
+// maxmsgsize only bounds how large a single record may get before msgtool splits it, it is not a slot size.
+template <std::size_t size, std::size_t maxmsgsize = 1024, typename StoragePolicy = container::storage::Inline>
+class VariableMessageLFQ : public container::LockFreeQueue<size, StoragePolicy> {
+    static_assert((size & (size - 1)) == 0, "size should be power of 2");
+
+   protected:
+    using parent = container::LockFreeQueue<size, StoragePolicy>;
+
+    struct RecordHeader {
+        // Bytes till the next record, header included. 0 marks the rest of the buffer as skipped.
+        std::uint32_t length;
+        std::uint32_t reserved;
+    };
+
+    static constexpr std::size_t recordAlign = sizeof(RecordHeader);
+    static constexpr std::uint32_t skipMarker = 0;
+
+    template <typename T>
+    static constexpr std::size_t recordSize() noexcept {
+        return (sizeof(RecordHeader) + sizeof(T) + recordAlign - 1) & ~(recordAlign - 1);
     }
+
+    template <typename MsgList, std::size_t idx = 0, bool = (idx == std::tuple_size<MsgList>::value)>
+    struct recordsizes {
+        static constexpr std::size_t value = recordSize<typename std::tuple_element<idx, MsgList>::type>() + recordsizes<MsgList, idx + 1>::value;
+    };
+    template <typename MsgList, std::size_t idx>
+    struct recordsizes<MsgList, idx, true> {
+        static constexpr std::size_t value = 0;
+    };
+
+    const RecordHeader *header() const { return static_cast<const RecordHeader *>(this->parent::front()); }
+
+   public:
+    explicit VariableMessageLFQ(std::size_t capacity_ = size) : parent{capacity_} {
+        static_assert(size == container::dynamicSize || recordSize<char[maxmsgsize]>() < size / 2, "maxmsgsize too large for queue");
+        if (recordSize<char[maxmsgsize]>() >= this->capacity() / 2) {
+            throw std::invalid_argument{"maxmsgsize too large for queue"};
+        }
+    }
+
+    std::size_t maxSize() const noexcept { return this->capacity() - recordAlign; };
+    static constexpr std::size_t msgSize() noexcept { return maxmsgsize; }
+
+    template <typename MsgList>
+    static constexpr std::size_t requiredSize() noexcept {
+        return recordsizes<MsgList>::value;
+    }
+
+    // Consumes the skip marker, if any, hence not const.
+    const Message *front() {
+        if (this->header()->length == skipMarker) {
+            this->updateHead(this->capacity() - this->getHead());
+        }
+        return reinterpret_cast<const Message *>(reinterpret_cast<const char *>(this->header()) + sizeof(RecordHeader));
+    }
+
+    void pop() { this->updateHead(this->header()->length); }
+
+    // offset is ignored, records are laid back to back from the private tail, which moves along with each of them.
+    template <typename T, typename... Args>
+    __attribute__((always_inline)) inline T *doOffsetEmplace(std::size_t offset, Args &&... args) {
+        static_assert(alignof(T) <= recordAlign, "Message over aligned for record");
+        constexpr auto length = recordSize<T>();
+        auto at = this->getProducerTail();
+        if (at + length > this->capacity()) {
+            this->template doAt<RecordHeader>(at, RecordHeader{skipMarker, 0});
+            this->advanceTail(this->capacity() - at);
+            at = 0;
+        }
+        this->template doAt<RecordHeader>(at, RecordHeader{static_cast<std::uint32_t>(length), 0});
+        T *msg = this->template doAt<T>(at + sizeof(RecordHeader), std::forward<Args>(args)...);
+        this->advanceTail(length);
+        return msg;
+    }
+
+    // A quarter only, a wrap may throw away as much as the record takes, see canEnqueue().
+    std::size_t spillRoom() const noexcept { return this->capacity() / 4; }
+
+    // Already moved by doOffsetEmplace, elemsize doesn't account for a skipped end of buffer anyway.
+    __attribute__((always_inline)) void advance(std::size_t elemsize) {}
+
+    __attribute__((always_inline)) void updateTail(std::size_t elemsize) { this->commit(); }
+
+    __attribute__((always_inline)) inline bool canEnqueue(std::size_t requiredSize) {
+        // Worst case a wrap throws away whatever is left till the end of buffer.
+        const std::size_t contiguous = this->capacity() - this->getProducerTail();
+        return this->reserve(requiredSize > contiguous ? requiredSize + contiguous : requiredSize);
+    }
+};
+
+// What SafeAsyncLogger and the msgenqueuer get to see as the queue while batching over FixedMessageLFQ/VariableMessageLFQ.
+// Records only move the private tail, all of them are published by one commit when the batch goes out of scope.
+template <typename Q>
+class BatchProducer {
+   private:
+    Q &queue;
+
+   public:
+    static constexpr std::size_t msgSize() noexcept { return Q::msgSize(); }
+
+    template <typename MsgList>
+    static constexpr std::size_t requiredSize() noexcept {
+        return Q::template requiredSize<MsgList>();
+    }
+
+    explicit BatchProducer(Q &queue_) : queue{queue_} {}
+    ~BatchProducer() { this->commit(); }
+    BatchProducer(const BatchProducer &) = delete;
+    BatchProducer &operator=(const BatchProducer &) = delete;
+
+    // When full, whatever the batch holds is published first so the consumer can make room. Otherwise Poll would wait on itself.
+    __attribute__((always_inline)) inline bool canEnqueue(std::size_t requiredSize) {
+        if (__builtin_expect(this->queue.canEnqueue(requiredSize), 1)) {
+            return true;
+        }
+        this->queue.commit();
+        return false;
+    }
+
+    template <typename T, typename... Args>
+    __attribute__((always_inline)) inline T *doOffsetEmplace(std::size_t offset, Args &&... args) {
+        return this->queue.template doOffsetEmplace<T>(offset, std::forward<Args>(args)...);
+    }
+
+    __attribute__((always_inline)) void updateTail(std::size_t elemsize) { this->queue.advance(elemsize); }
+
+    std::size_t spillRoom() const noexcept { return this->queue.spillRoom(); }
+
+    std::size_t fillSize() const { return this->queue.fillSize(); }
+
+    // Also done on destruction, calling it again is a no-op.
+    void commit() { this->queue.commit(); }
 };
 
 namespace msgtool {
@@ -217,26 +847,28 @@ struct msgenqueuer<false, MsgList, MsgListIdx, ArgsStartIdx, seq<S...>> {
     static_assert(MsgListIdx < MsgListSz, "MsgList Idx out of Bounds");
     static_assert(sizeof...(S) == FmtMsgArgCount, "Wrong Msg or Sequence");
 
+    // spilled: queue bytes taken so far by Continuations, everything after them moves along.
     template <typename Q, typename... Args>
-    __attribute__((always_inline)) inline static void enqueue(Q &queue, Args &&... args) {
+    __attribute__((always_inline)) inline static void enqueue(Q &queue, std::size_t spilled, Args &&... args) {
         // queue.template emplace<FmtMsg> (std::forward<typefiltered<S>>
         // (filterargs<S>::get(std::forward<Args>(args)...))...);
         // template <std::size_t I>
         // using std::forward<typename std::tuple_element<S,
         // std::tuple<Args>>::type>(std::get<S>(std::forward_as_tuple(args...)));
-        queue.template doOffsetEmplace<FmtMsg>(MsgListIdx * Q::msgSize(), std::forward<typename std::tuple_element<S, std::tuple<Args...>>::type>(
-                                                                              std::get<S>(std::forward_as_tuple(args...)))...);
+        FmtMsg *msg = queue.template doOffsetEmplace<FmtMsg>(MsgListIdx * Q::msgSize() + spilled, std::forward<typename std::tuple_element<S, std::tuple<Args...>>::type>(
+                                                                                                       std::get<S>(std::forward_as_tuple(args...)))...);
+        spilled += msg->spill(queue, (MsgListIdx + 1) * Q::msgSize() + spilled, spilled);
         using nextEnqueuer = typename makeEnqueuer<MsgList, MsgListIdx + 1, ArgsStartIdx + FmtMsgArgCount>::type;
-        nextEnqueuer::enqueue(queue, std::forward<Args>(args)...);
+        nextEnqueuer::enqueue(queue, spilled, std::forward<Args>(args)...);
     }
 };
 
 template <typename MsgList, std::size_t MsgListIdx, std::size_t ArgsStartIdx, typename Seq>
 struct msgenqueuer<true, MsgList, MsgListIdx, ArgsStartIdx, Seq> {
     template <typename Q, typename... Args>
-    __attribute__((always_inline)) inline static void enqueue(Q &queue, Args &&... args) {
+    __attribute__((always_inline)) inline static void enqueue(Q &queue, std::size_t spilled, Args &&... args) {
         static_assert(sizeof...(Args) == ArgsStartIdx, "Argument Index incorrect");
-        queue.updateTail(std::tuple_size<MsgList>::value * Q::msgSize());
+        queue.updateTail(Q::template requiredSize<MsgList>() + spilled);
         // Do nothing.
     }
 };
@@ -280,6 +912,39 @@ template <char delim, char end, typename labellist, typename... iArgs, std::size
 struct makemsglist<true, std::tuple<>, TimedFormattedMessage<delim, end, labellist, iArgs...>, msgsize, T, oArgs...>
     : msglist<std::tuple<TimedFormattedMessage<delim, delim, labellist, iArgs...>>, FormattedMessage<delim, end, T>, msgsize, oArgs...> {};
 
+// Same for FormatMessage and TimedFormatMessage. A new FormatMessage continues at the placeholder after the last one taken.
+template <typename TupleOfMsgs, char delim, char end, typename format, std::size_t first, typename... iArgs, std::size_t msgsize, typename T,
+          typename... oArgs>
+struct msglist<TupleOfMsgs, FormatMessage<delim, end, format, first, iArgs...>, msgsize, T, oArgs...>
+    : makemsglist<(sizeof(FormatMessage<delim, end, format, first, iArgs..., T>) > msgsize), TupleOfMsgs, FormatMessage<delim, end, format, first, iArgs...>,
+                  msgsize, T, oArgs...> {};
+
+template <char delim, char end, typename labellist, typename... iArgs, std::size_t msgsize, typename T, typename... oArgs>
+struct msglist<std::tuple<>, TimedFormatMessage<delim, end, labellist, iArgs...>, msgsize, T, oArgs...>
+    : makemsglist<(sizeof(TimedFormatMessage<delim, end, labellist, iArgs..., T>) > msgsize), std::tuple<>,
+                  TimedFormatMessage<delim, end, labellist, iArgs...>, msgsize, T, oArgs...> {};
+
+template <typename TupleOfMsgs, char delim, char end, typename format, std::size_t first, typename... iArgs, std::size_t msgsize, typename T,
+          typename... oArgs>
+struct makemsglist<false, TupleOfMsgs, FormatMessage<delim, end, format, first, iArgs...>, msgsize, T, oArgs...>
+    : msglist<TupleOfMsgs, FormatMessage<delim, end, format, first, iArgs..., T>, msgsize, oArgs...> {};
+
+template <char delim, char end, typename labellist, typename... iArgs, std::size_t msgsize, typename T, typename... oArgs>
+struct makemsglist<false, std::tuple<>, TimedFormatMessage<delim, end, labellist, iArgs...>, msgsize, T, oArgs...>
+    : msglist<std::tuple<>, TimedFormatMessage<delim, end, labellist, iArgs..., T>, msgsize, oArgs...> {};
+
+template <typename... Msgs, char delim, char end, typename format, std::size_t first, typename... iArgs, std::size_t msgsize, typename T,
+          typename... oArgs>
+struct makemsglist<true, std::tuple<Msgs...>, FormatMessage<delim, end, format, first, iArgs...>, msgsize, T, oArgs...>
+    : msglist<std::tuple<Msgs..., FormatMessage<delim, end, format, first, iArgs...>>, FormatMessage<delim, end, format, first + sizeof...(iArgs), T>,
+              msgsize, oArgs...> {};
+
+// iArgs start with the time, or void.
+template <char delim, char end, typename labellist, typename... iArgs, std::size_t msgsize, typename T, typename... oArgs>
+struct makemsglist<true, std::tuple<>, TimedFormatMessage<delim, end, labellist, iArgs...>, msgsize, T, oArgs...>
+    : msglist<std::tuple<TimedFormatMessage<delim, end, labellist, iArgs...>>,
+              FormatMessage<delim, end, typename labellist::formatct, sizeof...(iArgs) - 1, T>, msgsize, oArgs...> {};
+
 // Base Case.
 template <typename... Msgs, typename Fmsg, std::size_t msgsize>
 struct msglist<std::tuple<Msgs...>, Fmsg, msgsize> {
@@ -296,50 +961,164 @@ struct tmsglisttuplebuilder<true, delim, end, labellist, msgsize, T, Args...> {
     using type = typename msglist<std::tuple<>, TimedFormattedMessage<delim, end, labellist, T>, msgsize, Args...>::type;
 };
 
-template <char delim, char end, typename labellist, std::size_t msgsize, typename... Args>
+template <typename T>
+struct is_string_arg {
+    using type = typename std::decay<T>::type;
+    static constexpr bool value = std::is_same<type, std::string>::value || std::is_same<type, char *>::value || std::is_same<type, const char *>::value;
+};
+
+// Longest char* or std::string kept, inline in its message and in the slots after it. Anything longer is cut there, and all the strings
+// of a log call at spillBudget().
+static constexpr std::size_t maxCaptured = 4096;
+
+// Strings are captured, capacity bytes inline: as much room as a message of msgsize has for one (but no more than 240 bytes, every record
+// of the type pays for it), unless options::Capture says. The rest spills into the slots after the message. A char array takes no more
+// room than its own size, and is not cut at maxCaptured. The rest goes through as it is.
+template <typename T, std::size_t msgsize, std::size_t capacity, bool = is_string_arg<T>::value>
+struct capture {
+    using type = T;
+};
+template <typename T, std::size_t msgsize, std::size_t capacity>
+struct capture<T, msgsize, capacity, true> {
+    static_assert(msgsize >= 32, "msgsize too small to capture strings");
+    static constexpr std::size_t inlined = capacity != 0 ? capacity : (msgsize < 256 ? msgsize : 256) - 16;
+    static_assert(inlined >= 16 && inlined <= msgsize - 16, "options::Capture should be at least 16, and leave 16 bytes of msgsize");
+    // 0 unless a char array.
+    static constexpr std::size_t extent = std::extent<typename std::remove_reference<T>::type>::value;
+    using type = typename std::conditional<(extent == 0), Captured<T, inlined, maxCaptured>,
+                                           Captured<T, (extent < inlined ? extent : inlined), extent>>::type;
+};
+
+// Queue bytes of the Continuations a string argument spills into, C the argument as msgtool passes it on.
+template <typename Q, typename C>
+struct spillsize {
+    template <typename T>
+    static std::size_t of(const T &arg) {
+        return 0;
+    }
+};
+template <typename Q, typename T, std::size_t capacity, std::size_t limit>
+struct spillsize<Q, Captured<T, capacity, limit>> {
+    using stored = typename argtraits<Captured<T, capacity, limit>>::stored;
+    using chunk_t = Continuation<Q::msgSize()>;
+    template <typename A>
+    __attribute__((always_inline)) static std::size_t of(const A &arg) {
+        if (!stored::spills) {
+            return 0;
+        }
+        return (stored::spillOf(arg) + chunk_t::room - 1) / chunk_t::room * Q::template requiredSize<std::tuple<chunk_t>>();
+    }
+};
+
+template <typename Q, typename... Captured>
+struct spillsizes {
+    static std::size_t of() { return 0; }
+};
+template <typename Q, typename C, typename... Captured>
+struct spillsizes<Q, C, Captured...> {
+    template <typename T, typename... Args>
+    __attribute__((always_inline)) static std::size_t of(const T &arg, const Args &... args) {
+        return spillsize<Q, C>::of(arg) + spillsizes<Q, Captured...>::of(args...);
+    }
+};
+
+template <char delim, char end, typename labellist, std::size_t msgsize, std::size_t capacity, typename... Args>
 struct tmsglisttuple {
     static_assert(sizeof...(Args) == 0, "Empty case, no args should be here.");
     using type = typename tmsglisttuplebuilder<false, delim, end, labellist, msgsize, Args...>::type;
 };
 
-template <char delim, char end, typename labellist, std::size_t msgsize, typename T, typename... Args>
-struct tmsglisttuple<delim, end, labellist, msgsize, T, Args...> {
-    using type = typename tmsglisttuplebuilder<timestamp::is_time<T>::value, delim, end, labellist, msgsize, T, Args...>::type;
+template <char delim, char end, typename labellist, std::size_t msgsize, std::size_t capacity, typename T, typename... Args>
+struct tmsglisttuple<delim, end, labellist, msgsize, capacity, T, Args...> {
+    using type = typename tmsglisttuplebuilder<timestamp::is_time<T>::value, delim, end, labellist, msgsize, typename capture<T, msgsize, capacity>::type,
+                                               typename capture<Args, msgsize, capacity>::type...>::type;
 };
 
-template <char delim, char end, std::size_t msgsize, typename T, typename... Args>
+// tmsglisttuple for label::Formatted. The format has to have a placeholder for each argument, other than the time.
+template <char delim, char end, typename labellist, std::size_t msgsize, std::size_t capacity, typename... Args>
+struct fmsglisttuple {
+    static_assert(labellist::formatct::placeholders == sizeof...(Args), "Format placeholders don't match the arguments");
+    using type = typename msglist<std::tuple<>, TimedFormatMessage<delim, end, labellist, void>, msgsize, typename capture<Args, msgsize, capacity>::type...>::type;
+};
+
+template <char delim, char end, typename labellist, std::size_t msgsize, std::size_t capacity, typename T, typename... Args>
+struct fmsglisttuple<delim, end, labellist, msgsize, capacity, T, Args...> {
+    static constexpr bool timed = timestamp::is_time<T>::value;
+    static_assert(labellist::formatct::placeholders == sizeof...(Args) + (timed ? 0 : 1), "Format placeholders don't match the arguments");
+    using head = typename std::conditional<timed, TimedFormatMessage<delim, end, labellist, T>, TimedFormatMessage<delim, end, labellist, void>>::type;
+    using type = typename std::conditional<timed, msglist<std::tuple<>, head, msgsize, typename capture<Args, msgsize, capacity>::type...>,
+                                           msglist<std::tuple<>, head, msgsize, typename capture<T, msgsize, capacity>::type,
+                                                   typename capture<Args, msgsize, capacity>::type...>>::type::type;
+};
+
+template <char delim, char end, std::size_t msgsize, std::size_t capacity, typename T, typename... Args>
 struct msglisttuple {
-    using type = typename msglist<std::tuple<>, FormattedMessage<delim, end, T>, msgsize, Args...>::type;
+    using type = typename msglist<std::tuple<>, FormattedMessage<delim, end, typename capture<T, msgsize, capacity>::type>, msgsize,
+                                  typename capture<Args, msgsize, capacity>::type...>::type;
 };
 }    // msgtool end
 
-template <typename queue_t>
-class AsyncLogger : public Logger<LogFile::Stream> {
+// logfile: where the consumer writes to. Anything with a std::ostream file, a flush() and a due(), see Logger.
+// FlushPolicy: when run() flushes it, see FlushPolicy.hpp. The logfile's own due() by default.
+// capture: bytes of a string argument kept inline in its message, 0 for what a message has room for. See msgtool::capture.
+// Registered for crash::drainAll() while started, see CrashHandler.hpp. Consumed by a thread of its own, or by an Executor's, see Executor.hpp.
+template <typename queue_t, typename WaitPolicy = waitpolicy::Sleep, LogFile logfile = LogFile::Stream, TimeFormat timeformat = TimeFormat::Epoch, typename FlushPolicy = flushpolicy::Logfile,
+          std::size_t capture = 0>
+class AsyncLogger : public Logger<logfile>, public crash::Drainable, public executor::Serviced {
    private:
+    static_assert(std::is_base_of<waitpolicy::WaitPolicy, WaitPolicy>::value, "Wrong Wait policy");
+    static_assert(std::is_base_of<flushpolicy::FlushPolicy, FlushPolicy>::value, "Wrong Flush policy");
+
+    // Consumer state during a crash drain. Crashing is asked by the crashing thread, Parked is the consumer's answer.
+    enum CrashState : int { Running, Crashing, Parked };
+    std::atomic<int> crashState;
+
+    // Consumer, between two batches. Till the crashing thread is done with the queue.
+    __attribute__((noinline, cold)) void park() {
+        int expected = Crashing;
+        if (this->crashState.compare_exchange_strong(expected, Parked)) {
+            while (this->crashState.load(std::memory_order_acquire) == Parked) {
+                crash::nap();
+            }
+        }
+    }
+
     // Make a msg and keep splitting.
     // Make timedmsg
     template <typename labellist, std::size_t msgsize, char end, char delim, typename... Args>
-    using MsgList = typename msgtool::tmsglisttuple<delim, end, labellist, msgsize, Args...>::type;
+    using MsgList = typename std::conditional<label::is_formatted<labellist>::value, msgtool::fmsglisttuple<delim, end, labellist, msgsize, capture, Args...>,
+                                              msgtool::tmsglisttuple<delim, end, labellist, msgsize, capture, Args...>>::type::type;
 
     // Nontimed, rawmsg.
     template <std::size_t msgsize, char end, char delim, typename... Args>
-    using RawMsgList = typename msgtool::msglisttuple<delim, end, msgsize, Args...>::type;
+    using RawMsgList = typename msgtool::msglisttuple<delim, end, msgsize, capture, Args...>::type;
 
     template <typename M>
     using enqueuer = typename msgtool::makeEnqueuer<M, 0, 0>::type;
 
    protected:
-    using parent = Logger<LogFile::Stream>;
+    using parent = Logger<logfile>;
 
     // This is made a template parameter
     // static constexpr auto end = '\n';
 
     std::atomic<bool> stopAsync;
     std::thread asyncLogger;
-    unsigned int microsleep;
+    // Or an executor's threads, when started with one.
+    executor::Pool *pool;
+    std::size_t slot;
+    WaitPolicy waiter;
 
     queue_t queue;
 
+    // write() formats into this, run() drains it to the file once per batch.
+    text::Writer out;
+
+    // write() records every message to it, run() flushes when it says so.
+    FlushPolicy flushing;
+    std::uint64_t drained;    // out.written() as of the last batch.
+    flushpolicy::Counters flushes;
+
     template <std::size_t msgsize, typename labellist, char end, char delim, typename... Args>
     static constexpr std::size_t getMsgCount() noexcept {
         return std::tuple_size<MsgList<labellist, msgsize, end, delim, Args...>>::value;
@@ -350,58 +1129,176 @@ class AsyncLogger : public Logger<LogFile::Stream> {
         return std::tuple_size<RawMsgList<msgsize, end, delim, Args...>>::value;
     }
 
-    template <std::size_t msgsize, typename labellist, char end, char delim, typename... Args>
+    template <typename Q, typename labellist, char end, char delim, typename... Args>
     static constexpr std::size_t getRequiredSize() noexcept {
-        return getMsgCount<msgsize, labellist, end, delim, Args...>() * msgsize;
+        return Q::template requiredSize<MsgList<labellist, Q::msgSize(), end, delim, Args...>>();
     }
 
-    template <std::size_t msgsize, char end, char delim, typename... Args>
+    template <typename Q, char end, char delim, typename... Args>
     static constexpr std::size_t getRequiredSize() noexcept {
-        return getMsgCount<msgsize, end, delim, Args...>() * msgsize;
+        return Q::template requiredSize<RawMsgList<Q::msgSize(), end, delim, Args...>>();
+    }
+
+    // What the strings of a log call spill into the slots after their messages, on top of getRequiredSize(). 0 but for long ones.
+    template <typename Q, typename... Args>
+    __attribute__((always_inline)) static std::size_t getSpillSize(const Q &q, const Args &... args) {
+        const std::size_t spilled = msgtool::spillsizes<Q, typename msgtool::capture<Args, Q::msgSize(), capture>::type...>::of(args...);
+        if (__builtin_expect(spilled == 0, 1)) {
+            return 0;
+        }
+        const std::size_t budget = spillBudget(q);
+        return spilled < budget ? spilled : budget;
     }
 
     AsyncLogger(std::string &&filename, unsigned int microsleep_)
-        : parent{std::forward<std::string>(filename)}, stopAsync{false}, microsleep{microsleep_}, queue{} {}
+        : parent{std::forward<std::string>(filename)}, crashState{Running}, stopAsync{false}, pool{nullptr}, slot{0}, waiter{microsleep_}, queue{}, out{this->file, timeformat}, flushing{}, drained{0} {}
+
+    // For runtime sized queues, capacity in bytes. Anything after it goes to the Logger, eg. buffer size and threshold of LogFile::Fd.
+    template <typename... FileArgs>
+    AsyncLogger(std::string &&filename, unsigned int microsleep_, std::size_t capacity, FileArgs &&... fileargs)
+        : parent{std::forward<std::string>(filename), std::forward<FileArgs>(fileargs)...},
+          crashState{Running},
+          stopAsync{false},
+          pool{nullptr},
+          slot{0},
+          waiter{microsleep_},
+          queue{capacity},
+          out{this->file, timeformat},
+          flushing{},
+          drained{0} {}
 
     template <typename labellist, char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void log(Q &q, Args &&... args) {
-        enqueuer<MsgList<labellist, Q::msgSize(), end, delim, Args...>>::enqueue(q, std::forward<Args>(args)...);
+        enqueuer<MsgList<labellist, Q::msgSize(), end, delim, Args...>>::enqueue(q, 0, std::forward<Args>(args)...);
+        this->waiter.notify();
     }
 
     template <char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void lograw(Q &q, Args &&... args) {
-        enqueuer<RawMsgList<Q::msgSize(), end, delim, Args...>>::enqueue(q, std::forward<Args>(args)...);
+        enqueuer<RawMsgList<Q::msgSize(), end, delim, Args...>>::enqueue(q, 0, std::forward<Args>(args)...);
+        this->waiter.notify();
     }
 
     virtual ~AsyncLogger() {}
 
-    // Default run thread. Ideally only write function would change in derived
-    // classes.
-    void run(std::string &&threadname) {
-        if (const auto errornum = pthread_setname_np(this->asyncLogger.native_handle(), threadname.c_str())) {
-            throw std::runtime_error("LoggerName Error: " + std::to_string(errornum));
+    // One batch: write() whatever is queued, drain it to the logfile and flush it if the FlushPolicy says so. Whether anything was written.
+    bool service() override {
+        const bool wrote = this->write();
+        this->out.drain();
+        this->flushing.drained(this->out.written() - this->drained);
+        this->drained = this->out.written();
+        if (const unsigned reasons = this->flushing.due(*this)) {
+            this->flush();
+            this->flushing.flushed();
+            this->flushes.count(reasons);
         }
+        return wrote;
+    }
+
+    // Whatever was logged before stop().
+    void finish() {
+        this->writeAll();
+        this->out.drain();
+        this->flush();
+    }
 
+    // Default run thread. Ideally only write function would change in derived
+    // classes.
+    void run() {
         while (!this->stopAsync.load(std::memory_order_relaxed)) {
-            this->write();
-            this->flush();
-            if (microsleep > 0) {
-                usleep(microsleep);
+            if (__builtin_expect(this->crashState.load(std::memory_order_acquire) != Running, 0)) {
+                this->park();
             }
+            this->waiter.wait(this->service());
         }
+        this->finish();
     }
 
-    void start(std::string &&threadname) { asyncLogger = std::thread{&AsyncLogger::run, this, std::forward<std::string>(threadname)}; }
+    // Returns once the consumer is running as options say. Throws what setting it up did, the thread is gone then.
+    void start(std::string &&threadname, ThreadOptions options = ThreadOptions{}) {
+        this->queue.prefault();
+        this->asyncLogger = startThread(std::forward<std::string>(threadname), std::move(options), [this] { this->run(); });
+        crash::add(this);
+    }
+
+    // No thread of its own, serviced by executor's till stop(). Throws if it has no room for another logger.
+    void start(executor::Pool &executor) {
+        this->queue.prefault();
+        this->slot = executor.attach(this);
+        this->pool = &executor;
+        crash::add(this);
+    }
 
     void stop() {
+        crash::remove(this);
+        if (this->pool) {
+            this->pool->detach(this->slot);
+            this->pool = nullptr;
+            this->finish();
+            return;
+        }
         this->stopAsync = true;
+        this->waiter.wake();
         this->asyncLogger.join();
     }
 
     // Extra vtable solely because of this being used in run.
-    virtual void write() = 0;
+    // Returns whether anything was written, which is what the WaitPolicy backs off on.
+    virtual bool write() = 0;
+
+    // Everything queued, where write() may hold some back. On stop and on a crash.
+    virtual bool writeAll() { return this->write(); }
+
+    // What the consumer would do next, from the crashing thread once the consumer is parked. Not if the crash is the consumer's own,
+    // or if it doesn't park within crash::parkTimeout: it is busy with the queue and the file then.
+    // Attached to an executor, the slot is claimed instead, which its threads skip. Not if it is held by the crashing thread itself.
+    bool drainOnCrash() override {
+        if (this->pool) {
+            for (long waited = 0; !this->pool->claim(this->slot); waited += 100 * 1000) {
+                if (waited >= crash::parkTimeout) {
+                    return false;
+                }
+                crash::nap();
+            }
+            const bool drained = this->drainNow();
+            this->pool->release(this->slot);
+            return drained;
+        }
+        if (pthread_equal(pthread_self(), this->asyncLogger.native_handle())) {
+            return false;
+        }
+        this->crashState.store(Crashing, std::memory_order_seq_cst);
+        this->waiter.wake();
+        for (long waited = 0; this->crashState.load(std::memory_order_acquire) != Parked; waited += 100 * 1000) {
+            int expected = Crashing;
+            if (waited >= crash::parkTimeout && this->crashState.compare_exchange_strong(expected, Running)) {
+                return false;
+            }
+            crash::nap();
+        }
+        const bool drained = this->drainNow();
+        this->crashState.store(Running, std::memory_order_release);
+        return drained;
+    }
+
+    // The signal is raised again right after, nothing may be left in flight.
+    bool drainNow() {
+        try {
+            this->finish();
+            this->settle();
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    // Queued bytes, roughly, for executor::Order::Fill.
+    std::size_t backlog() const override { return executor::fillOf(this->queue, 0); }
 
    public:
+    // Flushes by run() so far and why, see FlushPolicy.hpp. Not the final one on stop.
+    flushpolicy::Stats getFlushStats() const { return this->flushes.get(); }
+
     // ---- commented out, not required after splitting of messages being done
     // Making a struct to check size is purely for showing the actual size vs msg
     // size in compiler error report.
@@ -0,0 +1,562 @@
+#ifndef _BINARY_FORMAT_HPP_
+#define _BINARY_FORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+namespace binary {
+// On disk format of the binary sink. Everything is host endian, the file is meant to be decoded on the same kind of box.
+//
+// The file is a sequence of records: u32 size of what follows, u16 id, payload.
+//   id Session:    "QLOGBIN" version, u32 length + text to emit as is (LoggerInit line). Starts a new set of descriptors, appended files have many.
+//   id Descriptor: u16 id being described, then the layout of a message type, see BasicLayout::describe.
+//   any other:     a message of that type, values back to back in Layout order. With prefixedTime set, an i64 microsecond time comes first,
+//                  the consumer's last time written in front of labelled messages that don't carry one.
+// Values are their raw bytes, strings are u32 length + bytes. Decoder writes them through the same ostream operators as the text loggers.
+
+static constexpr std::uint16_t Session = 0;
+static constexpr std::uint16_t Descriptor = 1;
+static constexpr std::uint16_t firstMessageId = 2;
+static constexpr std::uint16_t prefixedTime = 0x8000;
+static constexpr char magic[8] = {'Q', 'L', 'O', 'G', 'B', 'I', 'N', 1};
+
+enum class Code : std::uint8_t {
+    Text = 0,    // Anything else with an operator<<, formatted by the consumer.
+    Bool,
+    Char,
+    SChar,
+    UChar,
+    Short,
+    UShort,
+    Int,
+    UInt,
+    Long,
+    ULong,
+    LongLong,
+    ULongLong,
+    Float,
+    Double,
+    LongDouble,
+    String,
+    MicroTime,
+    NanoTime,
+    Fixed,     // FormattedValue<T, precision>: inner code, u8 precision.
+    Padded,    // FormattedValue<T, padding, width>: inner code, u8 padding, i32 width.
+};
+
+class Encoder;
+
+template <typename T, typename = void>
+struct codec {
+    static void describe(Encoder &enc);
+    static void encode(Encoder &enc, const T &value);
+};
+
+// Buffers records for the consumer, drained to the file in one write.
+class Encoder {
+   private:
+    template <typename L>
+    struct typekey {
+        static const char key;
+    };
+
+    std::string buffer;
+    std::unordered_map<const void *, std::uint16_t> ids;
+    std::uint16_t nextId;
+    std::size_t recordStart;
+
+    void begin(std::uint16_t id) {
+        this->recordStart = this->buffer.size();
+        this->put<std::uint32_t>(0);
+        this->put<std::uint16_t>(id);
+    }
+
+    void end() {
+        const auto size = static_cast<std::uint32_t>(this->buffer.size() - this->recordStart - sizeof(std::uint32_t));
+        std::memcpy(&this->buffer[this->recordStart], &size, sizeof(size));
+    }
+
+    template <typename L>
+    std::uint16_t idOf() {
+        const auto it = this->ids.find(&typekey<L>::key);
+        if (__builtin_expect(it != this->ids.end(), 1)) {
+            return it->second;
+        }
+        if (this->nextId >= prefixedTime) {
+            throw std::runtime_error{"Too many message types for binary log"};
+        }
+        const auto id = this->nextId++;
+        this->begin(Descriptor);
+        this->put<std::uint16_t>(id);
+        L::describe(*this);
+        this->end();
+        this->ids.emplace(&typekey<L>::key, id);
+        return id;
+    }
+
+   public:
+    Encoder() : nextId{firstMessageId}, recordStart{0} {}
+    // Out of line, it is never hot.
+    __attribute__((noinline)) ~Encoder() {}
+
+    template <typename T>
+    void put(const T &value) {
+        this->buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // The bytes of a string whose length was put on its own.
+    void putBytes(const char *bytes, std::size_t length) { this->buffer.append(bytes, length); }
+
+    void putString(const char *str, std::size_t length) {
+        this->put<std::uint32_t>(static_cast<std::uint32_t>(length));
+        this->buffer.append(str, length);
+    }
+
+    void session(const std::string &text) {
+        this->ids.clear();
+        this->nextId = firstMessageId;
+        this->begin(Session);
+        this->buffer.append(magic, sizeof(magic));
+        this->putString(text.data(), text.size());
+        this->end();
+    }
+
+    template <typename L, typename... Values>
+    void record(const timestamp::MicroSecondTime *prefix, const Values &... values) {
+        const auto id = this->idOf<L>();
+        this->begin(prefix ? id | prefixedTime : id);
+        if (prefix) {
+            this->put<std::int64_t>(prefix->getIntegral());
+        }
+        L::encode(*this, values...);
+        this->end();
+    }
+
+    std::size_t size() const { return this->buffer.size(); }
+
+    // Returns the bytes written.
+    std::size_t drainTo(std::ostream &os) {
+        const std::size_t size = this->buffer.size();
+        os.write(this->buffer.data(), size);
+        this->buffer.clear();
+        return size;
+    }
+};
+
+template <typename L>
+const char Encoder::typekey<L>::key = 0;
+
+template <typename T, Code c>
+struct scalarcodec {
+    static constexpr Code code = c;
+    static void describe(Encoder &enc) { enc.put<Code>(c); }
+    static void encode(Encoder &enc, const T &value) { enc.put<T>(value); }
+};
+
+template <>
+struct codec<bool> : scalarcodec<bool, Code::Bool> {};
+template <>
+struct codec<char> : scalarcodec<char, Code::Char> {};
+template <>
+struct codec<signed char> : scalarcodec<signed char, Code::SChar> {};
+template <>
+struct codec<unsigned char> : scalarcodec<unsigned char, Code::UChar> {};
+template <>
+struct codec<short> : scalarcodec<short, Code::Short> {};
+template <>
+struct codec<unsigned short> : scalarcodec<unsigned short, Code::UShort> {};
+template <>
+struct codec<int> : scalarcodec<int, Code::Int> {};
+template <>
+struct codec<unsigned int> : scalarcodec<unsigned int, Code::UInt> {};
+template <>
+struct codec<long> : scalarcodec<long, Code::Long> {};
+template <>
+struct codec<unsigned long> : scalarcodec<unsigned long, Code::ULong> {};
+template <>
+struct codec<long long> : scalarcodec<long long, Code::LongLong> {};
+template <>
+struct codec<unsigned long long> : scalarcodec<unsigned long long, Code::ULongLong> {};
+template <>
+struct codec<float> : scalarcodec<float, Code::Float> {};
+template <>
+struct codec<double> : scalarcodec<double, Code::Double> {};
+template <>
+struct codec<long double> : scalarcodec<long double, Code::LongDouble> {};
+
+// Pointers are followed, the text logger prints the string as well.
+template <typename T>
+struct codec<T *, typename std::enable_if<std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+    static void describe(Encoder &enc) { enc.put(Code::String); }
+    static void encode(Encoder &enc, const char *value) { enc.putString(value ? value : "", value ? std::strlen(value) : 0); }
+};
+
+template <>
+struct codec<std::string> {
+    static void describe(Encoder &enc) { enc.put(Code::String); }
+    static void encode(Encoder &enc, const std::string &value) { enc.putString(value.data(), value.size()); }
+};
+
+// A plain string to the decoder, spilled chunks and marker included.
+template <std::size_t capacity, bool movable, std::size_t limit>
+struct codec<CapturedString<capacity, movable, limit>> {
+    using marker = typename CapturedString<capacity, movable, limit>::marker;
+    static void describe(Encoder &enc) { enc.put(Code::String); }
+    static void encode(Encoder &enc, const CapturedString<capacity, movable, limit> &value) {
+        const std::size_t suffix = value.truncated() ? sizeof(marker::str) - 1 : 0;
+        enc.put<std::uint32_t>(static_cast<std::uint32_t>(value.size() + suffix));
+        value.forEach([&enc](const char *bytes, std::size_t length) { enc.putBytes(bytes, length); });
+        enc.putBytes(marker::str, suffix);
+    }
+};
+
+template <>
+struct codec<timestamp::MicroSecondTime> {
+    static void describe(Encoder &enc) { enc.put(Code::MicroTime); }
+    static void encode(Encoder &enc, const timestamp::MicroSecondTime &value) { enc.put<std::int64_t>(value.getIntegral()); }
+};
+
+template <clockid_t clk_id>
+struct codec<timestamp::NanoSecondTime<clk_id>> {
+    static void describe(Encoder &enc) { enc.put(Code::NanoTime); }
+    static void encode(Encoder &enc, const timestamp::NanoSecondTime<clk_id> &value) { enc.put<std::int64_t>(value.getIntegral()); }
+};
+
+// Converted when encoded, the file has nanoseconds.
+template <>
+struct codec<timestamp::TscTime> {
+    static void describe(Encoder &enc) { enc.put(Code::NanoTime); }
+    static void encode(Encoder &enc, const timestamp::TscTime &value) { enc.put<std::int64_t>(value.getIntegral()); }
+};
+
+template <typename T, int fixed_precision>
+struct codec<FormattedValue<T, fixed_precision>> {
+    using value_type = typename FormattedValue<T, fixed_precision>::value_type;
+    static void describe(Encoder &enc) {
+        const Code inner = codec<value_type>::code;
+        enc.put(Code::Fixed);
+        enc.put(inner);
+        enc.put<std::uint8_t>(fixed_precision);
+    }
+    static void encode(Encoder &enc, const FormattedValue<T, fixed_precision> &fv) { enc.put<value_type>(fv.value); }
+};
+
+template <typename T, int padding, int width>
+struct codec<FormattedValue<T, padding, width>> {
+    using value_type = typename FormattedValue<T, padding, width>::value_type;
+    static void describe(Encoder &enc) {
+        const Code inner = codec<value_type>::code;
+        enc.put(Code::Padded);
+        enc.put(inner);
+        enc.put<std::uint8_t>(padding);
+        enc.put<std::int32_t>(width);
+    }
+    static void encode(Encoder &enc, const FormattedValue<T, padding, width> &fv) { enc.put<value_type>(fv.value); }
+};
+
+// Fallback, formatted on the consumer side after all. Formats with a fresh stream, not the log file's.
+template <typename T, typename U>
+void codec<T, U>::describe(Encoder &enc) {
+    enc.put(Code::Text);
+}
+
+template <typename T, typename U>
+void codec<T, U>::encode(Encoder &enc, const T &value) {
+    std::ostringstream os;
+    os << value;
+    const auto str = os.str();
+    enc.putString(str.data(), str.size());
+}
+
+template <std::size_t idx, std::size_t size, typename Tuple>
+struct tupleencoder {
+    static void encode(Encoder &enc, const Tuple &t) {
+        using elem_t = typename std::tuple_element<idx, Tuple>::type;
+        codec<elem_t>::encode(enc, std::get<idx>(t));
+        tupleencoder<idx + 1, size, Tuple>::encode(enc, t);
+    }
+};
+
+template <std::size_t size, typename Tuple>
+struct tupleencoder<size, size, Tuple> {
+    static void encode(Encoder &enc, const Tuple &t) {}
+};
+
+// What follows each field of a delimited message: delim, nothing after the last one.
+template <char delim>
+struct Delimiters {
+    template <std::size_t idx, std::size_t size>
+    struct separator : std::conditional<(idx + 1 < size), stringct::StringCT<delim>, stringct::StringCT<>>::type {};
+};
+
+template <typename separators, std::size_t size, std::size_t idx, typename... Args>
+struct fielddescriber {
+    static void describe(Encoder &enc) {}
+};
+
+template <typename separators, std::size_t size, std::size_t idx, typename T, typename... Args>
+struct fielddescriber<separators, size, idx, T, Args...> {
+    static void describe(Encoder &enc) {
+        using separator = typename separators::template separator<idx, size>;
+        codec<T>::describe(enc);
+        enc.putString(separator::str, sizeof(separator::str) - 1);
+        fielddescriber<separators, size, idx + 1, Args...>::describe(enc);
+    }
+};
+
+// How a message type is laid out: [time] prefix arg separator arg separator... suffix. Time is void for none.
+// Mirrors what the messages' write() put out, see FormattedMessage and FormatMessage.
+template <typename prefix, typename separators, typename suffix, typename Time, typename... Args>
+struct BasicLayout {
+    template <typename T>
+    static void describeTime(Encoder &enc, T *) {
+        enc.put<std::uint8_t>(1);
+        codec<T>::describe(enc);
+    }
+    static void describeTime(Encoder &enc, void *) { enc.put<std::uint8_t>(0); }
+
+    static void describe(Encoder &enc) {
+        describeTime(enc, static_cast<Time *>(nullptr));
+        enc.putString(prefix::str, sizeof(prefix::str) - 1);
+        enc.put<std::uint16_t>(sizeof...(Args));
+        fielddescriber<separators, sizeof...(Args), 0, Args...>::describe(enc);
+        enc.putString(suffix::str, sizeof(suffix::str) - 1);
+    }
+
+    static void encode(Encoder &enc, const std::tuple<Args...> &data) { tupleencoder<0, sizeof...(Args), std::tuple<Args...>>::encode(enc, data); }
+
+    template <typename T>
+    static void encode(Encoder &enc, const T &tm, const std::tuple<Args...> &data) {
+        codec<T>::encode(enc, tm);
+        encode(enc, data);
+    }
+};
+
+template <char delim, typename prefix, typename suffix, typename Time, typename... Args>
+using Layout = BasicLayout<prefix, Delimiters<delim>, suffix, Time, Args...>;
+
+// Reads what Encoder wrote and renders the text the loggers would have.
+class Decoder {
+   private:
+    struct Field {
+        Code code;
+        Code inner;
+        std::uint8_t padding;    // Or precision.
+        std::int32_t width;
+    };
+
+    struct MessageLayout {
+        bool hasTime;
+        Field time;
+        std::string prefix;
+        std::vector<Field> args;
+        std::vector<std::string> separators;    // One after each of args.
+        std::string suffix;
+    };
+
+    std::vector<MessageLayout> layouts;
+
+    template <typename T>
+    static T take(const char *&p, const char *end) {
+        if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) {
+            throw std::runtime_error{"Truncated binary log record"};
+        }
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    static std::string takeString(const char *&p, const char *end) {
+        const auto length = take<std::uint32_t>(p, end);
+        if (static_cast<std::size_t>(end - p) < length) {
+            throw std::runtime_error{"Truncated binary log record"};
+        }
+        std::string str{p, length};
+        p += length;
+        return str;
+    }
+
+    static Field takeField(const char *&p, const char *end) {
+        Field f{take<Code>(p, end), Code::Text, 0, 0};
+        if (f.code == Code::Fixed) {
+            f.inner = take<Code>(p, end);
+            f.padding = take<std::uint8_t>(p, end);
+        } else if (f.code == Code::Padded) {
+            f.inner = take<Code>(p, end);
+            f.padding = take<std::uint8_t>(p, end);
+            f.width = take<std::int32_t>(p, end);
+        }
+        return f;
+    }
+
+    // Calls f.template apply<T>() with T the scalar type for code.
+    template <typename F>
+    static void dispatch(Code code, F &f) {
+        switch (code) {
+            case Code::Bool: f.template apply<bool>(); break;
+            case Code::Char: f.template apply<char>(); break;
+            case Code::SChar: f.template apply<signed char>(); break;
+            case Code::UChar: f.template apply<unsigned char>(); break;
+            case Code::Short: f.template apply<short>(); break;
+            case Code::UShort: f.template apply<unsigned short>(); break;
+            case Code::Int: f.template apply<int>(); break;
+            case Code::UInt: f.template apply<unsigned int>(); break;
+            case Code::Long: f.template apply<long>(); break;
+            case Code::ULong: f.template apply<unsigned long>(); break;
+            case Code::LongLong: f.template apply<long long>(); break;
+            case Code::ULongLong: f.template apply<unsigned long long>(); break;
+            case Code::Float: f.template apply<float>(); break;
+            case Code::Double: f.template apply<double>(); break;
+            case Code::LongDouble: f.template apply<long double>(); break;
+            default: throw std::runtime_error{"Unknown type code in binary log"};
+        }
+    }
+
+    struct Plain {
+        std::ostream &os;
+        const char *&p;
+        const char *end;
+        template <typename T>
+        void apply() {
+            this->os << take<T>(this->p, this->end);
+        }
+    };
+
+    struct Fixed {
+        std::ostream &os;
+        const char *&p;
+        const char *end;
+        int precision;
+        template <typename T>
+        void apply() {
+            writeFixed(this->os, take<T>(this->p, this->end), this->precision);
+        }
+    };
+
+    struct Padded {
+        std::ostream &os;
+        const char *&p;
+        const char *end;
+        int padding;
+        int width;
+        template <typename T>
+        void apply() {
+            writePadded(this->os, take<T>(this->p, this->end), this->padding, this->width);
+        }
+    };
+
+    static void render(std::ostream &os, const Field &f, const char *&p, const char *end) {
+        switch (f.code) {
+            case Code::Text:
+            case Code::String: os << takeString(p, end); break;
+            case Code::MicroTime: os << timestamp::MicroSecondTime{take<std::int64_t>(p, end)}; break;
+            case Code::NanoTime: os << timestamp::NanoSecondTime<>{take<std::int64_t>(p, end)}; break;
+            case Code::Fixed: {
+                Fixed fixed{os, p, end, f.padding};
+                dispatch(f.inner, fixed);
+                break;
+            }
+            case Code::Padded: {
+                Padded padded{os, p, end, f.padding, f.width};
+                dispatch(f.inner, padded);
+                break;
+            }
+            default: {
+                Plain plain{os, p, end};
+                dispatch(f.code, plain);
+            }
+        }
+    }
+
+    void session(const char *p, const char *end, std::ostream &os) {
+        if (end - p < static_cast<std::ptrdiff_t>(sizeof(magic)) || std::memcmp(p, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error{"Not a binary log, or unsupported version"};
+        }
+        p += sizeof(magic);
+        this->layouts.clear();
+        // A new session was a new ofstream, with default precision and fill.
+        const std::ios fresh{nullptr};
+        os.copyfmt(fresh);
+        os << takeString(p, end);
+    }
+
+    void describe(const char *p, const char *end) {
+        const auto id = take<std::uint16_t>(p, end);
+        if (id != this->layouts.size() + firstMessageId) {
+            throw std::runtime_error{"Out of order descriptor in binary log"};
+        }
+        MessageLayout l{};
+        l.hasTime = take<std::uint8_t>(p, end) != 0;
+        if (l.hasTime) {
+            l.time = takeField(p, end);
+        }
+        l.prefix = takeString(p, end);
+        const auto count = take<std::uint16_t>(p, end);
+        for (std::uint16_t i = 0; i < count; i++) {
+            l.args.push_back(takeField(p, end));
+            l.separators.push_back(takeString(p, end));
+        }
+        l.suffix = takeString(p, end);
+        this->layouts.push_back(std::move(l));
+    }
+
+    void message(std::uint16_t id, const char *p, const char *end, std::ostream &os) {
+        const auto idx = static_cast<std::size_t>(id & ~prefixedTime) - firstMessageId;
+        if (idx >= this->layouts.size()) {
+            throw std::runtime_error{"Message without descriptor in binary log"};
+        }
+        const auto &l = this->layouts[idx];
+        if (id & prefixedTime) {
+            os << timestamp::MicroSecondTime{take<std::int64_t>(p, end)};
+        }
+        if (l.hasTime) {
+            render(os, l.time, p, end);
+        }
+        os << l.prefix;
+        for (std::size_t i = 0; i < l.args.size(); i++) {
+            render(os, l.args[i], p, end);
+            os << l.separators[i];
+        }
+        os << l.suffix;
+    }
+
+   public:
+    // One record, starting at its size. Returns bytes consumed, 0 if more input is needed.
+    std::size_t decode(const char *data, std::size_t length, std::ostream &os) {
+        if (length < sizeof(std::uint32_t)) {
+            return 0;
+        }
+        std::uint32_t size;
+        std::memcpy(&size, data, sizeof(size));
+        if (length - sizeof(size) < size) {
+            return 0;
+        }
+        const char *p = data + sizeof(size);
+        const char *end = p + size;
+        const auto id = take<std::uint16_t>(p, end);
+        if (id == Session) {
+            this->session(p, end, os);
+        } else if (id == Descriptor) {
+            this->describe(p, end);
+        } else {
+            this->message(id, p, end, os);
+        }
+        return sizeof(size) + size;
+    }
+};
+
+}    // binary end
+}    // logger end
+}    // common end
+#endif
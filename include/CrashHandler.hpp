@@ -0,0 +1,166 @@
+#ifndef _CRASH_HANDLER_HPP_
+#define _CRASH_HANDLER_HPP_
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+
+namespace common {
+namespace logger {
+namespace crash {
+// Opt-in drain of the async loggers on a crash, install() once at startup. On SIGSEGV, SIGABRT, SIGBUS, SIGFPE or std::terminate:
+// producers are held at their next log call, every started logger's consumer is parked between two batches, and whatever is in its queues
+// is written out and flushed from the crashing thread. Then the signal is raised again, to whatever handled it before (the default: core).
+// Only syscalls and the logger's own formatting, no locks, and nothing allocated: owned strings are not freed, binary loggers are not
+// drained at all, their encoder allocates for a message type it has not seen. Not strictly async-signal-safe still: floating point goes
+// through snprintf, a Stream logfile is a filebuf. So the drain runs under alarm(drainTimeout), a drain stuck eg. in malloc on a corrupt
+// heap ends in SIGALRM's default, the process is killed. A crash in a consumer thread skips its own logger.
+// So messages need not be flushed after every batch for the sake of a crash, only for a kill -9 or power loss.
+
+// AsyncLogger, from start() to stop().
+class Drainable {
+   public:
+    // From the crashing thread, false if this logger couldn't be drained.
+    virtual bool drainOnCrash() = 0;
+
+   protected:
+    ~Drainable() = default;
+};
+
+// How long the crashing thread waits for a consumer to park, eg. one stuck in a write to a slow disk.
+static constexpr long parkTimeout = 200 * 1000 * 1000;    // ns
+// The whole drain, every logger parked and written out.
+static constexpr unsigned int drainTimeout = 30;    // s
+
+template <typename = void>
+struct Registry {
+    static constexpr std::size_t maxLoggers = 64;
+    static constexpr int signals[] = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE};
+    static std::atomic<Drainable *> loggers[maxLoggers];
+    static std::atomic<bool> holding;
+    static std::atomic<bool> draining;
+    static struct sigaction previous[sizeof(signals) / sizeof(signals[0])];
+    static std::terminate_handler previousTerminate;
+};
+
+template <typename T>
+constexpr int Registry<T>::signals[];
+template <typename T>
+std::atomic<Drainable *> Registry<T>::loggers[Registry<T>::maxLoggers];
+template <typename T>
+std::atomic<bool> Registry<T>::holding{false};
+template <typename T>
+std::atomic<bool> Registry<T>::draining{false};
+template <typename T>
+struct sigaction Registry<T>::previous[sizeof(Registry<T>::signals) / sizeof(Registry<T>::signals[0])];
+template <typename T>
+std::terminate_handler Registry<T>::previousTerminate = nullptr;
+
+// Whether log calls should wait, one relaxed load.
+__attribute__((always_inline)) inline bool holding() { return Registry<>::holding.load(std::memory_order_relaxed); }
+
+// Whether a crash drain has begun, from then on nothing may be freed.
+inline bool draining() { return Registry<>::draining.load(std::memory_order_relaxed); }
+
+// Producers, only while a drain is in progress.
+__attribute__((noinline, cold)) inline void hold() {
+    while (Registry<>::holding.load(std::memory_order_acquire)) {
+        sched_yield();
+    }
+}
+
+inline void nap() {
+    const timespec ts{0, 100 * 1000};
+    nanosleep(&ts, nullptr);
+}
+
+// False if all maxLoggers slots are taken, the logger is then left out of a crash drain.
+inline bool add(Drainable *logger) {
+    for (auto &slot : Registry<>::loggers) {
+        Drainable *empty = nullptr;
+        if (slot.compare_exchange_strong(empty, logger)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// SIGALRM to its default, killing the process, and unblocked in the crashing thread. Previous alarms are replaced, the process ends anyway.
+inline void watchdog(unsigned int seconds) {
+    struct sigaction action {};
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, nullptr);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+    ::alarm(seconds);
+}
+
+inline void remove(Drainable *logger) {
+    for (auto &slot : Registry<>::loggers) {
+        Drainable *self = logger;
+        if (slot.compare_exchange_strong(self, nullptr)) {
+            return;
+        }
+    }
+}
+
+// Once per process, whichever crash comes first. Returns the number of loggers drained.
+inline std::size_t drainAll() {
+    if (Registry<>::draining.exchange(true)) {
+        return 0;
+    }
+    watchdog(drainTimeout);
+    Registry<>::holding.store(true, std::memory_order_seq_cst);
+    std::size_t drained = 0;
+    for (auto &slot : Registry<>::loggers) {
+        if (Drainable *logger = slot.load(std::memory_order_acquire)) {
+            drained += logger->drainOnCrash();
+        }
+    }
+    Registry<>::holding.store(false, std::memory_order_release);
+    ::alarm(0);
+    return drained;
+}
+
+inline void onSignal(int sig, siginfo_t *info, void *context) {
+    drainAll();
+    for (std::size_t i = 0; i < sizeof(Registry<>::signals) / sizeof(Registry<>::signals[0]); i++) {
+        if (Registry<>::signals[i] == sig) {
+            sigaction(sig, &Registry<>::previous[i], nullptr);
+        }
+    }
+    // Blocked till this returns, then delivered to the previous handler.
+    raise(sig);
+}
+
+[[noreturn]] inline void onTerminate() {
+    drainAll();
+    if (Registry<>::previousTerminate) {
+        Registry<>::previousTerminate();
+    }
+    std::abort();
+}
+
+// Installs the signal handlers and the terminate handler, keeping the previous ones to pass on to. Once, before any crash can happen.
+inline void install() {
+    struct sigaction action {};
+    action.sa_sigaction = &onSignal;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (std::size_t i = 0; i < sizeof(Registry<>::signals) / sizeof(Registry<>::signals[0]); i++) {
+        sigaction(Registry<>::signals[i], &action, &Registry<>::previous[i]);
+    }
+    Registry<>::previousTerminate = std::set_terminate(&onTerminate);
+}
+}    // crash end
+}    // logger end
+}    // common end
+#endif
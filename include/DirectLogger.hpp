@@ -0,0 +1,205 @@
+#ifndef _DIRECT_LOGGER_HPP_
+#define _DIRECT_LOGGER_HPP_
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <system_error>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+
+// Output buffer of LogFile::Direct. The file is written in whole aligned blocks only, from one aligned buffer that is always in step with
+// the file: buffer[0] is at a block boundary, base. Full blocks are written as they fill, the partial block behind them moves to the front.
+// A flush writes the partial block as well, zero padded, and cuts the file back to its real size. That block is written again with the next.
+// On open, the file's own partial last block is read back into the buffer, so appending works as usual.
+class DirectBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t writes;
+        std::uint64_t bytes;
+    };
+
+    static constexpr std::size_t blocksize = 4096;
+
+   private:
+    const int fd;
+    const std::size_t capacity;
+    const std::size_t threshold;
+    const std::chrono::microseconds maxDelay;
+    std::chrono::steady_clock::time_point lastWrite;
+    char *buffer;
+    char *mark;    // Where pptr() was after the last write, nothing new past it means nothing to flush.
+    std::uint64_t base;
+    std::atomic<std::uint64_t> writes;
+    std::atomic<std::uint64_t> bytes;
+
+    static void check(bool ok, const char *what) {
+        if (!ok) {
+            throw std::system_error{errno, std::generic_category(), what};
+        }
+    }
+
+    void writeAt(const char *data, std::size_t length, std::uint64_t offset) {
+        const auto calls = writeAll(this->fd, data, length, offset);
+        this->writes.store(this->writes.load(std::memory_order_relaxed) + calls, std::memory_order_relaxed);
+        this->bytes.store(this->bytes.load(std::memory_order_relaxed) + length, std::memory_order_relaxed);
+    }
+
+    // Full blocks out. With pad the partial block too, padded, and the file truncated to size.
+    void writeOut(bool pad) {
+        const std::size_t pending = this->pptr() - this->pbase();
+        const std::size_t full = pending & ~(blocksize - 1);
+        const std::size_t tail = pending - full;
+        if (pad && tail != 0) {
+            // full + blocksize still fits, capacity is whole blocks.
+            std::memset(this->buffer + pending, 0, blocksize - tail);
+            this->writeAt(this->buffer, full + blocksize, this->base);
+            check(ftruncate(this->fd, this->base + pending) == 0, "Logfile truncate");
+        } else if (full != 0) {
+            this->writeAt(this->buffer, full, this->base);
+        }
+        if (full != 0) {
+            std::memmove(this->buffer, this->buffer + full, tail);
+            this->base += full;
+            this->setp(this->buffer, this->buffer + this->capacity);
+            this->pbump(static_cast<int>(tail));
+        }
+        this->mark = this->pptr();
+        this->lastWrite = std::chrono::steady_clock::now();
+    }
+
+   protected:
+    void writeOut() override { this->writeOut(false); }
+    void flushOut() override {
+        if (this->pptr() != this->mark) {
+            this->writeOut(true);
+        }
+    }
+
+   public:
+    // capacity is rounded up to whole blocks, two at least.
+    DirectBuffer(int fd_, std::size_t capacity_, std::size_t threshold_, unsigned int maxDelay_)
+        : fd{fd_},
+          capacity{std::max((capacity_ + blocksize - 1) & ~(blocksize - 1), 2 * blocksize)},
+          threshold{threshold_},
+          maxDelay{maxDelay_},
+          lastWrite{std::chrono::steady_clock::now()},
+          buffer{nullptr},
+          mark{nullptr},
+          base{0},
+          writes{0},
+          bytes{0} {
+        if (this->threshold > this->capacity) {
+            throw std::invalid_argument{"Direct buffer threshold should be within its size"};
+        }
+        void *mem = nullptr;
+        if (posix_memalign(&mem, blocksize, this->capacity) != 0) {
+            throw std::bad_alloc{};
+        }
+        this->buffer = static_cast<char *>(mem);
+        this->setp(this->buffer, this->buffer + this->capacity);
+        if (fd_ >= 0) {
+            const auto size = lseek(fd_, 0, SEEK_END);
+            if (size < 0) {
+                const int error = errno;
+                std::free(this->buffer);
+                throw std::system_error{error, std::generic_category(), "Logfile seek"};
+            }
+            this->base = size & ~static_cast<std::uint64_t>(blocksize - 1);
+            const std::size_t tail = size - this->base;
+            if (tail != 0) {
+                const auto got = ::pread(fd_, this->buffer, blocksize, this->base);
+                if (got != static_cast<ssize_t>(tail)) {
+                    std::free(this->buffer);
+                    throw std::system_error{got < 0 ? errno : EIO, std::generic_category(), "Logfile read"};
+                }
+                this->pbump(static_cast<int>(tail));
+            }
+        }
+        this->mark = this->pptr();
+    }
+    ~DirectBuffer() { std::free(this->buffer); }
+    DirectBuffer(DirectBuffer &&) = delete;
+
+    bool due() const {
+        return static_cast<std::size_t>(this->pptr() - this->pbase()) >= this->threshold ||
+               (this->pptr() != this->mark && std::chrono::steady_clock::now() - this->lastWrite >= this->maxDelay);
+    }
+    Stats getStats() const { return Stats{this->writes.load(std::memory_order_relaxed), this->bytes.load(std::memory_order_relaxed)}; }
+};
+
+// O_DIRECT, keeping the log out of the page cache and away from dirty page writeback. Flushed like LogFile::Fd, by threshold and maxDelay.
+// Where O_DIRECT isn't supported (eg. tmpfs) the file is opened without it, written the same way. See direct().
+template <>
+class Logger<LogFile::Direct> : public AbstractLogger {
+   public:
+    static constexpr std::size_t defaultBufferSize = 4 * 1024 * 1024;
+    static constexpr unsigned int defaultMaxDelay = 1000;
+
+   private:
+    bool isDirect;
+    UniqueFd fd;
+    DirectBuffer buffer;
+
+    int open(const std::string &filename) {
+        // Read too, for the partial last block.
+        const int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+        const int direct = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+        if (direct >= 0 || errno != EINVAL) {
+            return direct;
+        }
+        this->isDirect = false;
+        return ::open(filename.c_str(), flags, 0644);
+    }
+
+   protected:
+    std::ostream file;
+    // threshold = 0 is half the buffer. maxDelay in microseconds.
+    Logger(std::string &&filename, std::size_t bufferSize = defaultBufferSize, std::size_t threshold = 0, unsigned int maxDelay = defaultMaxDelay)
+        : isDirect{true},
+          fd{this->open(filename)},
+          buffer{this->fd.get(), bufferSize, threshold ? threshold : bufferSize / 2, maxDelay},
+          file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() {
+        this->flush();
+        this->close();
+    }
+    void check() {
+        if (this->fd.get() < 0) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    bool due() const { return this->buffer.due(); }
+    void close() {
+        if (this->fd.get() >= 0) {
+            this->flush();
+            this->fd.close();
+        }
+    }
+    std::ostream &getFile() { return this->file; }
+    bool direct() const { return this->isDirect; }
+    DirectBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+}    // logger end
+}    // common end
+#endif
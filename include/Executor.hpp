@@ -0,0 +1,243 @@
+#ifndef _EXECUTOR_HPP_
+#define _EXECUTOR_HPP_
+
+#include <sched.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <ThreadOptions.hpp>
+#include <WaitPolicy.hpp>
+
+namespace common {
+namespace logger {
+namespace executor {
+// Consumer threads shared by many async loggers, instead of a thread per logger. A logger started with an Executor keeps its own queues,
+// logfile, format and flush policy, the executor's threads take turns with it: one batch, as its own thread would write in one round, then
+// on to the next logger. A logger is serviced by one thread at a time, whichever claims its slot first, not always the same one.
+
+// AsyncLogger, from start(executor) to stop().
+class Serviced {
+   public:
+    // One batch, whether anything was written. Only ever from whoever holds the logger's slot.
+    virtual bool service() = 0;
+    // Bytes queued, roughly. 0 where the queue can't tell, eg. PerThreadAsyncLogger's.
+    virtual std::size_t backlog() const = 0;
+
+   protected:
+    ~Serviced() = default;
+};
+
+// q.fillSize(), where the queue has one.
+template <typename Q>
+auto fillOf(const Q &q, int) -> decltype(static_cast<std::size_t>(q.fillSize())) {
+    return q.fillSize();
+}
+template <typename Q>
+std::size_t fillOf(const Q &q, long) {
+    return 0;
+}
+
+// The order a thread goes through the loggers in every round. RoundRobin starts one logger further each round, Fill at the largest backlog,
+// so that a busy logger is drained before the idle ones are even looked at.
+enum class Order { RoundRobin, Fill };
+
+// The slots loggers are attached to, without the threads. What AsyncLogger::start takes.
+class Pool {
+   public:
+    static constexpr std::size_t maxLoggers = 64;
+
+   private:
+    struct Slot {
+        std::atomic<bool> busy;    // Held by whoever services the logger, attaches or detaches it.
+        std::atomic<Serviced *> logger;
+    } __attribute__((aligned(64)));
+
+    Slot slots[maxLoggers];
+    std::atomic<std::size_t> used;    // Slots ever attached to, threads look no further.
+
+    void hold(std::size_t i) {
+        while (!this->claim(i)) {
+            sched_yield();
+        }
+    }
+
+   protected:
+    std::size_t inUse() const { return this->used.load(std::memory_order_acquire); }
+
+    // One batch of the logger in slot i, if there is one and nobody else has it.
+    bool service(std::size_t i) {
+        if (!this->slots[i].logger.load(std::memory_order_relaxed) || !this->claim(i)) {
+            return false;
+        }
+        bool wrote = false;
+        if (Serviced *logger = this->slots[i].logger.load(std::memory_order_relaxed)) {
+            wrote = logger->service();
+        }
+        this->release(i);
+        return wrote;
+    }
+
+    // Same, the backlog. 0 if it isn't there or busy.
+    std::size_t backlog(std::size_t i) {
+        if (!this->slots[i].logger.load(std::memory_order_relaxed) || !this->claim(i)) {
+            return 0;
+        }
+        std::size_t bytes = 0;
+        if (Serviced *logger = this->slots[i].logger.load(std::memory_order_relaxed)) {
+            bytes = logger->backlog();
+        }
+        this->release(i);
+        return bytes;
+    }
+
+   public:
+    Pool() : slots{}, used{0} {}
+    Pool(Pool &&) = delete;
+
+    bool claim(std::size_t i) {
+        return !this->slots[i].busy.load(std::memory_order_relaxed) && !this->slots[i].busy.exchange(true, std::memory_order_acquire);
+    }
+    void release(std::size_t i) { this->slots[i].busy.store(false, std::memory_order_release); }
+
+    // The slot, throws if all maxLoggers are taken.
+    std::size_t attach(Serviced *logger) {
+        for (std::size_t i = 0; i < maxLoggers; i++) {
+            if (this->slots[i].logger.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            this->hold(i);
+            Serviced *empty = nullptr;
+            const bool attached = this->slots[i].logger.compare_exchange_strong(empty, logger, std::memory_order_relaxed);
+            this->release(i);
+            if (attached) {
+                auto used_ = this->used.load(std::memory_order_relaxed);
+                while (used_ < i + 1 && !this->used.compare_exchange_weak(used_, i + 1, std::memory_order_release, std::memory_order_relaxed)) {
+                    // Retry.
+                }
+                return i;
+            }
+        }
+        throw std::runtime_error("Executor full: " + std::to_string(maxLoggers) + " loggers");
+    }
+
+    // Returns once no thread is servicing it, and none will.
+    void detach(std::size_t i) {
+        this->hold(i);
+        this->slots[i].logger.store(nullptr, std::memory_order_relaxed);
+        this->release(i);
+    }
+};
+}    // executor end
+
+// threads consumer threads for any number of loggers, eg. a dozen mostly idle ones on a single housekeeping core:
+//     Executor<> executor{"qlogexec", 1, executor::Order::RoundRobin, 1000, ThreadOptions{}.affinity({0})};
+//     LoggerManager<SpscAsyncLogger<64, 1024>> main{executor, "main.log", 0u}, send{executor, "send.log", 0u};
+// Each thread waits as WaitPolicy says after a round with nothing written, producers don't notify it: a Backoff one parks for its
+// timeout at most. Threads are named name0, name1 and so on. Loggers are stopped before the executor is destroyed.
+template <typename WaitPolicy = waitpolicy::Sleep>
+class Executor : public executor::Pool {
+   private:
+    static_assert(std::is_base_of<waitpolicy::WaitPolicy, WaitPolicy>::value, "Wrong Wait policy");
+
+    struct Worker {
+        WaitPolicy waiter;
+        std::thread thread;
+
+        explicit Worker(unsigned int microsleep) : waiter{microsleep}, thread{} {}
+    };
+
+    // Over aligned waiters, plain new doesn't honour that in c++11.
+    static Worker *make(unsigned int microsleep) {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, alignof(Worker), sizeof(Worker)) != 0) {
+            throw std::bad_alloc{};
+        }
+        return new (mem) Worker{microsleep};
+    }
+
+    static void destroy(Worker *worker) {
+        worker->~Worker();
+        free(worker);
+    }
+
+    const executor::Order order;
+    std::atomic<bool> stopping;
+    std::vector<Worker *> workers;
+
+    void run(Worker &worker, std::size_t first) {
+        std::array<std::pair<std::size_t, std::size_t>, maxLoggers> byfill;
+        std::size_t round = first;
+        while (!this->stopping.load(std::memory_order_relaxed)) {
+            const auto used = this->inUse();
+            bool wrote = false;
+            if (this->order == executor::Order::Fill) {
+                for (std::size_t i = 0; i < used; i++) {
+                    byfill[i] = std::make_pair(this->backlog(i), i);
+                }
+                std::sort(byfill.begin(), byfill.begin() + used, [](const std::pair<std::size_t, std::size_t> &a, const std::pair<std::size_t, std::size_t> &b) {
+                    return a.first > b.first;
+                });
+                for (std::size_t i = 0; i < used; i++) {
+                    wrote |= this->service(byfill[i].second);
+                }
+            } else if (used > 0) {
+                for (std::size_t i = 0; i < used; i++) {
+                    wrote |= this->service((round + i) % used);
+                }
+                round++;
+            }
+            worker.waiter.wait(wrote);
+        }
+    }
+
+    void shutdown() {
+        this->stopping = true;
+        for (auto worker : this->workers) {
+            worker->waiter.wake();
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+            destroy(worker);
+        }
+        this->workers.clear();
+    }
+
+   public:
+    // Every thread set up as options say, see ThreadOptions. Throws what that did, no threads are left then.
+    Executor(std::string &&name, std::size_t threads, executor::Order order_ = executor::Order::RoundRobin, unsigned int microsleep = 1000,
+             ThreadOptions options = ThreadOptions{})
+        : Pool{}, order{order_}, stopping{false}, workers{} {
+        if (threads == 0) {
+            throw std::invalid_argument("Executor needs a thread");
+        }
+        this->workers.reserve(threads);
+        try {
+            for (std::size_t i = 0; i < threads; i++) {
+                this->workers.push_back(make(microsleep));
+                Worker &worker = *this->workers.back();
+                // Threads start a round apart, so that they don't all go for the same logger first.
+                worker.thread = startThread(name + std::to_string(i), ThreadOptions{options}, [this, &worker, i] { this->run(worker, i); });
+            }
+        } catch (...) {
+            this->shutdown();
+            throw;
+        }
+    }
+    Executor(Executor &&) = delete;
+
+    ~Executor() { this->shutdown(); }
+
+    std::size_t threads() const { return this->workers.size(); }
+};
+}    // logger end
+}    // common end
+#endif
@@ -0,0 +1,170 @@
+#ifndef _FLUSH_POLICY_HPP_
+#define _FLUSH_POLICY_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace common {
+namespace logger {
+namespace flushpolicy {
+// When AsyncLogger::run flushes the logfile after a batch. Consumer only, one per logger, picked at compile time.
+// record(level) is called for every message written, drained(bytes) after every batch with what went to the logfile since the last one,
+// due(logger) then says why a flush is due, if it is, and flushed() follows the flush. Unflushed bytes are still written once the
+// logfile's own buffer is full, the policy only decides about the rest.
+struct FlushPolicy {};
+
+// Bits of what due() returns, counted in Stats.
+enum Reason : unsigned { ByLogfile = 1, BySize = 2, ByAge = 4, BySeverity = 8 };
+
+struct Stats {
+    std::uint64_t flushes;
+    // Flushes by reason, one flush counts for each reason it was due for.
+    std::uint64_t byLogfile;
+    std::uint64_t bySize;
+    std::uint64_t byAge;
+    std::uint64_t bySeverity;
+};
+
+// Written by the consumer, read by anyone.
+class Counters {
+   private:
+    std::atomic<std::uint64_t> counts[5];
+
+    void bump(std::size_t i) { this->counts[i].store(this->counts[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+   public:
+    Counters() : counts{} {}
+
+    void count(unsigned reasons) {
+        this->bump(0);
+        for (std::size_t i = 0; i < 4; i++) {
+            if (reasons & (1u << i)) {
+                this->bump(i + 1);
+            }
+        }
+    }
+    Stats get() const {
+        return Stats{this->counts[0].load(std::memory_order_relaxed), this->counts[1].load(std::memory_order_relaxed), this->counts[2].load(std::memory_order_relaxed),
+                     this->counts[3].load(std::memory_order_relaxed), this->counts[4].load(std::memory_order_relaxed)};
+    }
+};
+
+// What run() always did, whenever the logfile's due() says so. Every batch for Stream, see Logger.
+class Logfile : public FlushPolicy {
+   public:
+    void record(std::uint8_t level) {}
+    void drained(std::size_t bytes) {}
+    template <typename L>
+    unsigned due(L &logger) {
+        return logger.due() ? ByLogfile : 0u;
+    }
+    void flushed() {}
+};
+
+// Once bytes have been written since the last flush. Alone it never flushes a trickle, combine it with Age.
+template <std::size_t bytes>
+class Bytes : public FlushPolicy {
+   private:
+    std::size_t pending;
+
+   public:
+    Bytes() : pending{0} {}
+
+    void record(std::uint8_t level) {}
+    void drained(std::size_t written) { this->pending += written; }
+    template <typename L>
+    unsigned due(L &logger) {
+        return this->pending >= bytes ? BySize : 0u;
+    }
+    void flushed() { this->pending = 0; }
+};
+
+// Once the oldest unflushed record has waited microseconds, counted from the batch that wrote it.
+template <unsigned int microseconds>
+class Age : public FlushPolicy {
+   private:
+    bool pending;
+    std::chrono::steady_clock::time_point oldest;
+
+   public:
+    Age() : pending{false}, oldest{} {}
+
+    void record(std::uint8_t level) {}
+    void drained(std::size_t written) {
+        if (written != 0 && !this->pending) {
+            this->pending = true;
+            this->oldest = std::chrono::steady_clock::now();
+        }
+    }
+    template <typename L>
+    unsigned due(L &logger) {
+        return this->pending && std::chrono::steady_clock::now() - this->oldest >= std::chrono::microseconds{microseconds} ? ByAge : 0u;
+    }
+    void flushed() { this->pending = false; }
+};
+
+// After any batch with a record of minlevel or above, eg. level::WARN. Raw messages have no level, see label::severity.
+template <typename minlevel>
+class Severity : public FlushPolicy {
+   private:
+    bool pending;
+
+   public:
+    Severity() : pending{false} {}
+
+    void record(std::uint8_t level) { this->pending |= level >= minlevel::value; }
+    void drained(std::size_t written) {}
+    template <typename L>
+    unsigned due(L &logger) {
+        return this->pending ? BySeverity : 0u;
+    }
+    void flushed() { this->pending = false; }
+};
+
+// Due whenever any of Policies is, eg. Any<Bytes<1 << 20>, Age<10000>, Severity<level::WARN>>.
+template <typename... Policies>
+class Any;
+
+template <>
+class Any<> : public FlushPolicy {
+   public:
+    void record(std::uint8_t level) {}
+    void drained(std::size_t written) {}
+    template <typename L>
+    unsigned due(L &logger) {
+        return 0;
+    }
+    void flushed() {}
+};
+
+template <typename Policy, typename... Policies>
+class Any<Policy, Policies...> : public FlushPolicy {
+   private:
+    Policy first;
+    Any<Policies...> rest;
+
+   public:
+    void record(std::uint8_t level) {
+        this->first.record(level);
+        this->rest.record(level);
+    }
+    void drained(std::size_t written) {
+        this->first.drained(written);
+        this->rest.drained(written);
+    }
+    template <typename L>
+    unsigned due(L &logger) {
+        return this->first.due(logger) | this->rest.due(logger);
+    }
+    void flushed() {
+        this->first.flushed();
+        this->rest.flushed();
+    }
+};
+
+}    // flushpolicy end
+}    // logger end
+}    // common end
+#endif
@@ -2,45 +2,109 @@
 #define _LOCK_FREE_QUEUE_HPP_
 
 #include <atomic>
+#include <climits>
 #include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "QueueStorage.hpp"
 
 namespace common {
 namespace container {
+// Fixed capacity is a constant, folded into every mask.
 template <std::size_t size>
-class LockFreeQueue {
+struct Capacity {
+    static_assert(size <= INT_MAX, "head and tail are ints");
+    explicit Capacity(std::size_t) {}
+    static constexpr std::size_t capacity() noexcept { return size; }
+};
+
+// dynamicSize: one read only member, the mask costs a load the compiler hoists out of any loop.
+template <>
+struct Capacity<dynamicSize> {
+   private:
+    const std::size_t cap;
+
+   public:
+    explicit Capacity(std::size_t capacity_) : cap{capacity_} {
+        if (capacity_ == 0 || (capacity_ & (capacity_ - 1)) != 0) {
+            throw std::invalid_argument{"Queue capacity should be power of 2"};
+        }
+        // head and tail are ints.
+        if (capacity_ > static_cast<std::size_t>(INT_MAX)) {
+            throw std::invalid_argument{"Queue capacity should be at most 1GB"};
+        }
+    }
+    std::size_t capacity() const noexcept { return this->cap; }
+};
+
+// size is either fixed, or dynamicSize with the capacity given to the constructor. The latter needs separately allocated storage, eg. Mapped.
+template <std::size_t size, typename StoragePolicy = storage::Inline>
+class LockFreeQueue : public Capacity<size> {
+    static_assert(std::is_base_of<storage::StoragePolicy, StoragePolicy>::value, "Wrong Storage policy");
+
    private:
     std::atomic<int> head __attribute__((aligned(64)));
     // char head_padding[128];
     std::atomic<int> tail __attribute__((aligned(64)));
     // char tail_padding[128];
-    char buffer[size] __attribute__((aligned(64)));
-    // char *buffer = new char[size];
+    // Producer only, never read by the consumer.
+    // producerTail runs ahead of tail by whatever is reserved but not yet committed. cachedHead is a stale copy of head.
+    std::size_t producerTail __attribute__((aligned(64)));
+    std::size_t cachedHead;
+    typename StoragePolicy::template type<size> buffer __attribute__((aligned(64)));
     // char buffer_padding[128];
 
     // protected:
    public:
     template <typename T>
     __attribute__((always_inline)) void doPush(const T &arg) {
-        const T *storeAt = this->buffer + this->tail.load(std::memory_order_acquire);
+        const T *storeAt = this->buffer.data() + this->producerTail;
         *storeAt = arg;
     }
 
     template <typename T, typename... Args>
     __attribute__((always_inline)) void doEmplace(Args &&... args) {
-        new (this->buffer + this->tail.load(std::memory_order_acquire)) T{std::forward<Args>(args)...};
+        new (this->buffer.data() + this->producerTail) T{std::forward<Args>(args)...};
     }
 
     template <typename T, typename... Args>
-    __attribute__((always_inline)) inline void doOffsetEmplace(std::size_t offset, Args &&... args) {
-        new (this->buffer + ((this->tail.load(std::memory_order_relaxed) + offset) & (size - 1))) T{std::forward<Args>(args)...};
+    __attribute__((always_inline)) inline T *doOffsetEmplace(std::size_t offset, Args &&... args) {
+        return new (this->buffer.data() + ((this->producerTail + offset) & (this->capacity() - 1))) T{std::forward<Args>(args)...};
     }
 
-    __attribute__((always_inline)) void updateTail(std::size_t elemsize) { this->tail = ((this->tail + elemsize) & (size - 1)); }
+    template <typename T, typename... Args>
+    __attribute__((always_inline)) inline T *doAt(std::size_t pos, Args &&... args) {
+        return new (this->buffer.data() + pos) T{std::forward<Args>(args)...};
+    }
 
-    __attribute__((always_inline)) void updateHead(std::size_t elemsize) { this->head = ((this->head + elemsize) & (size - 1)); }
+    // Producer side. reserve() checks, advanceTail() moves the private tail, commit() makes all of it visible to the consumer at once.
+    // There is only one producer, so nothing else can take reserved space. head is re-read only when the cached copy says there isn't enough.
+    __attribute__((always_inline)) inline bool reserve(std::size_t elemsize) {
+        const std::size_t cap = this->capacity();
+        if (__builtin_expect(((cap + this->producerTail - this->cachedHead) & (cap - 1)) + elemsize < cap, 1)) {
+            return true;
+        }
+        this->cachedHead = this->head.load(std::memory_order_acquire);
+        return ((cap + this->producerTail - this->cachedHead) & (cap - 1)) + elemsize < cap;
+    }
+
+    __attribute__((always_inline)) void advanceTail(std::size_t elemsize) { this->producerTail = (this->producerTail + elemsize) & (this->capacity() - 1); }
+
+    __attribute__((always_inline)) void commit() { this->tail.store(this->producerTail, std::memory_order_release); }
+
+    __attribute__((always_inline)) void updateTail(std::size_t elemsize) {
+        this->advanceTail(elemsize);
+        this->commit();
+    }
+
+    __attribute__((always_inline)) void updateHead(std::size_t elemsize) { this->head = ((this->head + elemsize) & (this->capacity() - 1)); }
 
    public:
-    LockFreeQueue() : head{0}, tail{0} { static_assert((size & (size - 1)) == 0, "size should be power of 2"); }
+    explicit LockFreeQueue(std::size_t capacity_ = size)
+        : Capacity<size>{capacity_}, head{0}, tail{0}, producerTail{0}, cachedHead{0}, buffer{capacity_} {
+        static_assert((size & (size - 1)) == 0, "size should be power of 2");
+    }
     ~LockFreeQueue() {}
     LockFreeQueue(LockFreeQueue &&) = delete;
     LockFreeQueue operator=(LockFreeQueue &&) = delete;
@@ -58,17 +122,21 @@ class LockFreeQueue {
     }
 
     // This is just a guess.
-    std::size_t fillSize() const { return ((size + this->tail - this->head) & (size - 1)); }
+    std::size_t fillSize() const { return ((this->capacity() + this->tail - this->head) & (this->capacity() - 1)); }
 
     bool empty() const { return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire); }
 
-    const void *front(int offset = 0) const { return this->buffer + ((this->head.load(std::memory_order_acquire) + offset) & (size - 1)); }
+    const void *front(int offset = 0) const { return this->buffer.data() + ((this->head.load(std::memory_order_acquire) + offset) & (this->capacity() - 1)); }
 
     __attribute__((always_inline)) void pop(std::size_t popsize) { this->updateHead(popsize); }
 
+    // Once, before the first push. See StoragePolicy.
+    void prefault() { this->buffer.prefault(); }
+
     // Exposed mostly for debugging. Shouldn't be required elsewhere.
     int getHead(std::memory_order mo = std::memory_order_relaxed) const { return this->head.load(mo); }
     int getTail(std::memory_order mo = std::memory_order_relaxed) const { return this->tail.load(mo); }
+    std::size_t getProducerTail() const { return this->producerTail; }
 };    // __attribute__((aligned (64)));
 }
 }
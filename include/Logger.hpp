@@ -1,17 +1,35 @@
 #ifndef _LOGGER_HPP_
 #define _LOGGER_HPP_
 
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <ios>
 #include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <system_error>
 #include <thread>
 #include <tuple>
 
+#include "Executor.hpp"
 #include "LockFreeQueue.hpp"
 #include "StringCT.hpp"
+#include "ThreadOptions.hpp"
 #include "TimeStamp.hpp"
+#include "TscTimeStamp.hpp"
 
 namespace common {
 namespace logger {
@@ -46,11 +64,60 @@ struct LabelList {
         using type = typename std::tuple_element<i, std::tuple<Args...>>::type;
     };
 };
+
+// Labels of a message written through format, SCT("fill {} @ {} qty={}"), instead of delimited. The async loggers log<labellist, format>().
+// Still the labels for anything else, eg. a backup logger just writes the fields delimited.
+template <typename labellist, typename format>
+struct Formatted : labellist {
+    using formatct = typename stringct::PlaceholderFormatCT<format>::type;
+};
+
+template <typename T>
+struct is_formatted : std::false_type {};
+template <typename labellist, typename format>
+struct is_formatted<Formatted<labellist, format>> : std::true_type {};
+
+template <typename L, bool = is_level<L>::value>
+struct firstlevel {
+    static constexpr uint8_t value = 0;
+};
+template <typename L>
+struct firstlevel<L, true> {
+    static constexpr uint8_t value = std::decay<L>::type::value;
+};
+
+template <typename L, typename... Args>
+firstlevel<L> levelof(const LabelList<L, Args...> *);
+firstlevel<void> levelof(const LabelList<> *);
+
+// Level value of a labellist, its first label if that is one, as DEBUG otherwise. Formatted ones too.
+template <typename labellist>
+struct severity : decltype(levelof(static_cast<const labellist *>(nullptr))) {};
 }
 
 // DD: Need to wrap info in struct. PlaceHolder should also have information what it is a placeholder for.
 static const char PlaceHolder = '0';
 
+// What FormattedValue prints as, shared with binary::Decoder which has to reproduce it byte for byte.
+// Only flags are restored, precision and fill stick to the stream as they always did.
+template <typename T>
+std::ostream &writeFixed(std::ostream &os, const T &value, int fixed_precision) {
+    const auto fmtflags = os.flags();
+    os << std::setprecision(fixed_precision) << std::fixed;
+    os << value;
+    os.flags(fmtflags);
+    return os;
+}
+
+template <typename T>
+std::ostream &writePadded(std::ostream &os, const T &value, int padding, int width) {
+    const auto fmtflags = os.flags();
+    os << std::setfill((char)padding) << std::setw(width);
+    os << value;
+    os.flags(fmtflags);
+    return os;
+}
+
 template <typename T, int...>
 struct FormattedValue;
 template <typename T>
@@ -75,13 +142,7 @@ struct FormattedValue<T, fixed_precision> : FormattedValue<T> {
 
     FormattedValue<T, fixed_precision>(T value) : FormattedValue<T>{value} {};
 
-    friend std::ostream &operator<<(std::ostream &os, const FormattedValue<T, fixed_precision> &fv) {
-        const auto fmtflags = os.flags();
-        os << std::setprecision(fixed_precision) << std::fixed;
-        os << fv.value;
-        os.flags(fmtflags);
-        return os;
-    }
+    friend std::ostream &operator<<(std::ostream &os, const FormattedValue<T, fixed_precision> &fv) { return writeFixed(os, fv.value, fixed_precision); }
 };
 
 template <typename T, int padding, int width>
@@ -94,16 +155,134 @@ struct FormattedValue<T, padding, width> : FormattedValue<T> {
 
     FormattedValue<T, padding, width>(T value) : FormattedValue<T>{value} {};
 
-    friend std::ostream &operator<<(std::ostream &os, const FormattedValue<T, padding, width> &fv) {
-        const auto fmtflags = os.flags();
-        os << std::setfill((char)padding) << std::setw(width);
-        os << fv.value;
-        os.flags(fmtflags);
+    friend std::ostream &operator<<(std::ostream &os, const FormattedValue<T, padding, width> &fv) { return writePadded(os, fv.value, padding, width); }
+};
+
+// What a CapturedString spills, in the queue slots after its message: a chain of chunks, each followed by its bytes.
+struct SpillChunk {
+    SpillChunk *next;
+    std::uint32_t length;
+
+    const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+};
+
+// A string argument as a message keeps it, never a pointer to the caller's bytes: length and the bytes, copied in. Up to capacity
+// bytes inline. limit > capacity: up to limit bytes in all, whatever doesn't fit spilled into the slots after the message, see spill().
+// Anything longer than limit is cut there, and written with marker after it.
+// movable: a std::string&& longer than capacity is moved in whole instead, taking over its buffer without allocating. The consumer frees it
+// with release() once written, nothing is ever destroyed on the producer side.
+template <std::size_t capacity, bool movable = false, std::size_t limit = capacity>
+class CapturedString {
+   public:
+    using marker = stringct::StringCT<'.', '.', '.'>;
+    static constexpr bool spills = limit > capacity;
+
+   private:
+    static_assert(!movable || capacity >= sizeof(std::string), "No room to move a std::string in");
+    static_assert(!movable || !spills, "A movable string doesn't spill");
+    static_assert(!spills || capacity >= 2 * sizeof(SpillChunk *), "No room to link the spilled bytes");
+    enum Flags : std::uint8_t { Truncated = 1, Owned = 2, Spilled = 4 };
+
+    // Inline bytes of a spilled string. The pointer after them is the caller's rest till spill(), its first chunk from then on.
+    static constexpr std::size_t head = spills ? capacity - sizeof(SpillChunk *) : capacity;
+
+    std::uint32_t length;
+    std::uint8_t flags;
+    typename std::aligned_storage<capacity, movable ? alignof(std::string) : 1>::type bytes;
+
+    static std::size_t kept(std::size_t length_) { return length_ > limit ? limit : length_; }
+
+    __attribute__((always_inline)) void copy(const char *str, std::size_t length_) {
+        const std::size_t n = kept(length_);
+        this->flags = length_ > limit ? Truncated : 0;
+        this->length = static_cast<std::uint32_t>(n);
+        const bool spilled = spills && n > capacity;
+        std::memcpy(&this->bytes, str, spilled ? head : n);
+        if (spilled) {
+            this->flags |= Spilled;
+            this->link(str + head);
+        }
+    }
+
+    template <typename P>
+    P linked() const {
+        P p;
+        std::memcpy(&p, reinterpret_cast<const char *>(&this->bytes) + head, sizeof(p));
+        return p;
+    }
+    template <typename P>
+    void link(P p) {
+        std::memcpy(reinterpret_cast<char *>(&this->bytes) + head, &p, sizeof(p));
+    }
+
+    void take(std::string &&str, std::false_type) { this->copy(str.data(), str.size()); }
+    void take(std::string &&str, std::true_type) {
+        if (str.size() <= capacity) {
+            this->copy(str.data(), str.size());
+        } else {
+            new (&this->bytes) std::string{std::move(str)};
+            this->flags = Owned;
+            this->length = 0;
+        }
+    }
+
+    const std::string *owned() const { return reinterpret_cast<const std::string *>(&this->bytes); }
+
+   public:
+    __attribute__((always_inline)) CapturedString(const char *str) { this->copy(str ? str : "", str ? strlen(str) : 0); }
+    __attribute__((always_inline)) CapturedString(const std::string &str) { this->copy(str.data(), str.size()); }
+    __attribute__((always_inline)) CapturedString(std::string &&str) { this->take(std::move(str), std::integral_constant<bool, movable>{}); }
+
+    // Bytes of str that would be spilled, before it is captured.
+    static std::size_t spillOf(const char *str) { return spills && str ? spillOf(strlen(str)) : 0; }
+    static std::size_t spillOf(const std::string &str) { return spills ? spillOf(str.size()) : 0; }
+    static std::size_t spillOf(std::size_t length_) { return kept(length_) > capacity ? kept(length_) - head : 0; }
+
+    // Producer, right after the message is constructed: the caller's bytes that didn't fit, and the chunks they were copied to.
+    std::size_t spilled() const { return (spills && (this->flags & Spilled)) ? this->length - head : 0; }
+    const char *rest() const { return this->linked<const char *>(); }
+    void spill(SpillChunk *first) { this->link(first); }
+    // Only spilled bytes of the rest were taken, the queue had no room for more.
+    void cut(std::size_t spilled_) {
+        this->length = static_cast<std::uint32_t>(head + spilled_);
+        this->flags |= Truncated;
+    }
+
+    const char *data() const { return (this->flags & Owned) ? this->owned()->data() : reinterpret_cast<const char *>(&this->bytes); }
+    std::size_t size() const { return (this->flags & Owned) ? this->owned()->size() : this->length; }
+    bool truncated() const { return this->flags & Truncated; }
+
+    // f(bytes, length) for each piece, in order: the inline bytes, or the moved in string, then the spilled chunks.
+    template <typename F>
+    void forEach(F f) const {
+        if (!spills || !(this->flags & Spilled)) {
+            f(this->data(), this->size());
+            return;
+        }
+        f(this->data(), head);
+        for (const SpillChunk *chunk = this->linked<const SpillChunk *>(); chunk; chunk = chunk->next) {
+            f(chunk->data(), chunk->length);
+        }
+    }
+
+    // The moved in string, if any, is gone after this. The message is read once, so const.
+    void release() const {
+        if (movable && (this->flags & Owned)) {
+            this->owned()->~basic_string();
+        }
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const CapturedString &cs) {
+        cs.forEach([&os](const char *bytes, std::size_t length) { os.write(bytes, length); });
+        if (cs.truncated()) {
+            os.write(marker::str, sizeof(marker::str) - 1);
+        }
         return os;
     }
 };
 
-enum class LogFile { _Base_, Stream, Posix };
+// Uring is in UringLogger.hpp, Direct in DirectLogger.hpp, Mmap in MmapLogger.hpp, Lz in LzLogger.hpp, Rotate in RotatingLogger.hpp.
+enum class LogFile { _Base_, Stream, Posix, Fd, Uring, Direct, Mmap, Lz, Rotate };
 
 struct LoggerDefaults {
     static constexpr char defaultDelim = ',';
@@ -113,11 +292,33 @@ struct LoggerDefaults {
 template <LogFile logfile>
 class Logger;
 
+// The fd of a logfile, closed with it. Opened before the logfile's buffer, so that it is closed even if the buffer throws.
+class UniqueFd {
+   private:
+    int fd;
+
+   public:
+    explicit UniqueFd(int fd_) : fd{fd_} {}
+    ~UniqueFd() { this->close(); }
+    UniqueFd(UniqueFd &&) = delete;
+
+    int get() const { return this->fd; }
+    void close() {
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+};
+
 class AbstractLogger {
    protected:
     // override or keep empty;
     void start(std::string &&name) {}
     void stop() {}
+    // After flush() on a crash, whatever the file still needs before the process goes: Uring waits for the writes in flight, Mmap cuts
+    // the file back to what was written.
+    void settle() {}
 };
 
 template <>
@@ -139,6 +340,8 @@ class Logger<LogFile::Stream> : public AbstractLogger {
     Logger(std::ofstream &file_) = delete;    // access modifier is checked before delete.
     Logger(Logger &&) = delete;
     void flush() { this->file.flush(); }
+    // Whether AsyncLogger::run flushes after a batch. Always, the filebuf is small anyway.
+    bool due() const { return true; }
     void close() { this->file.close(); }
     std::ofstream &getFile() { return file; }
 };
@@ -167,6 +370,196 @@ class Logger<LogFile::Posix> : public AbstractLogger {
     FILE *getFile() { return file; }
 };
 
+// Put area of the logfile buffers, this one's and the other LogFile headers'. writeOut() makes room once it is full: writes out what is
+// there, or whatever else the buffer does then. flushOut() is what a flush does, writeOut() unless overridden. Both on the consumer only.
+class LogBuffer : public std::streambuf {
+   protected:
+    static constexpr std::uint64_t noOffset = std::uint64_t(-1);
+
+    virtual void writeOut() = 0;
+    virtual void flushOut() { this->writeOut(); }
+
+    // All of it, short writes are continued. At offset, or where the file is for noOffset. Returns the syscalls it took.
+    // Throwing leaves the stream bad, like a failed filebuf.
+    __attribute__((noinline)) static std::uint64_t writeAll(int fd, iovec *iov, int count, std::uint64_t offset = noOffset) {
+        std::uint64_t syscalls = 0;
+        while (count > 0) {
+            const auto written = offset == noOffset ? ::writev(fd, iov, count) : ::pwritev(fd, iov, count, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error{errno, std::generic_category(), "Logfile write"};
+            }
+            syscalls++;
+            if (offset != noOffset) {
+                offset += written;
+            }
+            auto left = static_cast<std::size_t>(written);
+            for (; count > 0 && left >= iov->iov_len; ++iov, --count) {
+                left -= iov->iov_len;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+                iov->iov_len -= left;
+            }
+        }
+        return syscalls;
+    }
+
+    static std::uint64_t writeAll(int fd, const char *data, std::size_t length, std::uint64_t offset = noOffset) {
+        iovec iov{const_cast<char *>(data), length};
+        return writeAll(fd, &iov, length ? 1 : 0, offset);
+    }
+
+    int_type overflow(int_type c) override {
+        this->writeOut();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *this->pptr() = traits_type::to_char_type(c);
+            this->pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *str, std::streamsize length) override {
+        std::streamsize left = length;
+        while (left > 0) {
+            if (this->pptr() == this->epptr()) {
+                this->writeOut();
+            }
+            const auto chunk = std::min<std::streamsize>(left, this->epptr() - this->pptr());
+            std::memcpy(this->pptr(), str, chunk);
+            this->pbump(static_cast<int>(chunk));
+            str += chunk;
+            left -= chunk;
+        }
+        return length;
+    }
+
+    int sync() override {
+        this->flushOut();
+        return 0;
+    }
+};
+
+// Output buffer of LogFile::Fd. One page aligned buffer, written with a single writev(2) once it is full or flushed.
+// due() once threshold bytes are pending, or once anything is and maxDelay has passed since the last write.
+// A chunk that doesn't fit goes out in the same writev as the buffer, without being copied in first.
+class FdBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t syscalls;
+        std::uint64_t bytes;
+        double bytesPerSyscall() const { return this->syscalls ? static_cast<double>(this->bytes) / this->syscalls : 0; }
+    };
+
+   private:
+    static constexpr std::size_t pagesize = 4096;
+
+    const int fd;
+    const std::size_t capacity;
+    const std::size_t threshold;
+    const std::chrono::microseconds maxDelay;
+    std::chrono::steady_clock::time_point lastWrite;
+    char *buffer;
+    // Written by the consumer only, atomic so that they can be read while it runs.
+    std::atomic<std::uint64_t> syscalls;
+    std::atomic<std::uint64_t> bytes;
+
+    void writeOut(const char *extra, std::size_t length) {
+        iovec iov[2] = {{this->pbase(), static_cast<std::size_t>(this->pptr() - this->pbase())}, {const_cast<char *>(extra), length}};
+        const std::size_t total = iov[0].iov_len + length;
+        const auto calls = writeAll(this->fd, iov[0].iov_len ? iov : iov + 1, (iov[0].iov_len ? 1 : 0) + (length ? 1 : 0));
+        this->syscalls.store(this->syscalls.load(std::memory_order_relaxed) + calls, std::memory_order_relaxed);
+        this->bytes.store(this->bytes.load(std::memory_order_relaxed) + total, std::memory_order_relaxed);
+        this->setp(this->buffer, this->buffer + this->capacity);
+        this->lastWrite = std::chrono::steady_clock::now();
+    }
+
+   protected:
+    void writeOut() override { this->writeOut(nullptr, 0); }
+
+    std::streamsize xsputn(const char *str, std::streamsize length) override {
+        if (length <= this->epptr() - this->pptr()) {
+            std::memcpy(this->pptr(), str, length);
+            this->pbump(static_cast<int>(length));
+        } else {
+            this->writeOut(str, length);
+        }
+        return length;
+    }
+
+   public:
+    // capacity is rounded up to whole pages.
+    FdBuffer(int fd_, std::size_t capacity_, std::size_t threshold_, unsigned int maxDelay_)
+        : fd{fd_},
+          capacity{(capacity_ + pagesize - 1) & ~(pagesize - 1)},
+          threshold{threshold_},
+          maxDelay{maxDelay_},
+          lastWrite{std::chrono::steady_clock::now()},
+          buffer{nullptr},
+          syscalls{0},
+          bytes{0} {
+        if (this->capacity == 0 || this->threshold > this->capacity) {
+            throw std::invalid_argument{"Fd buffer threshold should be within its size"};
+        }
+        void *mem = nullptr;
+        if (posix_memalign(&mem, pagesize, this->capacity) != 0) {
+            throw std::bad_alloc{};
+        }
+        this->buffer = static_cast<char *>(mem);
+        this->setp(this->buffer, this->buffer + this->capacity);
+    }
+    ~FdBuffer() { std::free(this->buffer); }
+    FdBuffer(FdBuffer &&) = delete;
+
+    bool due() const {
+        const auto pending = static_cast<std::size_t>(this->pptr() - this->pbase());
+        return pending >= this->threshold || (pending != 0 && std::chrono::steady_clock::now() - this->lastWrite >= this->maxDelay);
+    }
+    Stats getStats() const { return Stats{this->syscalls.load(std::memory_order_relaxed), this->bytes.load(std::memory_order_relaxed)}; }
+};
+
+// Plain fd with a large user space buffer. AsyncLogger::run flushes only when the buffer is due, see FdBuffer.
+// So under load there is one syscall per threshold instead of one per batch, and a line waits at most about maxDelay microseconds.
+template <>
+class Logger<LogFile::Fd> : public AbstractLogger {
+   public:
+    static constexpr std::size_t defaultBufferSize = 4 * 1024 * 1024;
+    static constexpr unsigned int defaultMaxDelay = 1000;
+
+   private:
+    UniqueFd fd;
+    FdBuffer buffer;
+
+   protected:
+    std::ostream file;
+    // threshold = 0 is half the buffer. maxDelay in microseconds.
+    Logger(std::string &&filename, std::size_t bufferSize = defaultBufferSize, std::size_t threshold = 0, unsigned int maxDelay = defaultMaxDelay)
+        : fd{::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)},
+          buffer{this->fd.get(), bufferSize, threshold ? threshold : bufferSize / 2, maxDelay},
+          file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() {
+        this->flush();
+        this->close();
+    }
+    void check() {
+        if (this->fd.get() < 0) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    bool due() const { return this->buffer.due(); }
+    void close() { this->fd.close(); }
+    std::ostream &getFile() { return this->file; }
+    FdBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+
 // Optional Helper Class: LoggerManager.
 
 template <typename L>
@@ -186,6 +579,18 @@ class LoggerManager : public L {
         this->L::start(std::forward<std::string>(name));
     }
 
+    // Async loggers only, their consumer thread set up as options say. See ThreadOptions.
+    template <typename... Args>
+    LoggerManager(ThreadOptions options, std::string &&name, Args &&... args) : L{std::forward<Args>(args)...} {
+        this->L::start(std::forward<std::string>(name), std::move(options));
+    }
+
+    // Async loggers only, serviced by executor's threads instead of one of their own. See Executor.hpp.
+    template <typename... Args>
+    LoggerManager(executor::Pool &executor, Args &&... args) : L{std::forward<Args>(args)...} {
+        this->L::start(executor);
+    }
+
     ~LoggerManager() { this->L::stop(); }
 
     // Should not be required.
@@ -0,0 +1,117 @@
+#ifndef _LOGGER_OPTIONS_HPP_
+#define _LOGGER_OPTIONS_HPP_
+
+#include <type_traits>
+#include <FlushPolicy.hpp>
+#include <Logger.hpp>
+#include <QueueStorage.hpp>
+#include <TextFormat.hpp>
+
+namespace common {
+namespace logger {
+namespace options {
+namespace detail {
+struct StorageKind {};
+struct FileKind {};
+struct TimeKind {};
+struct FlushKind {};
+struct HoldbackKind {};
+struct CaptureKind {};
+
+// Whether a setting of kind is among Settings.
+template <typename kind, typename... Settings>
+struct given : std::false_type {};
+template <typename kind, typename Setting, typename... Settings>
+struct given<kind, Setting, Settings...> : std::integral_constant<bool, std::is_same<kind, typename Setting::kind>::value || given<kind, Settings...>::value> {};
+}    // detail end
+
+// What an async logger takes after its WaitPolicy, as one parameter. Any of these, in any order, the rest keep their defaults:
+//     SpscAsyncLogger<64, 1024, safetypolicy::Poll, waitpolicy::Sleep, options::Options<options::File<LogFile::Fd>, options::Flush<flushpolicy::Bytes<1 << 20>>>>
+
+// Default container::storage::Inline. Not for MpscAsyncLogger, its queue has no StoragePolicy.
+template <typename StoragePolicy>
+struct Storage {
+    using kind = detail::StorageKind;
+};
+// Default LogFile::Stream.
+template <LogFile logfile>
+struct File {
+    using kind = detail::FileKind;
+};
+// Default TimeFormat::Epoch. Not for BinarySpscAsyncLogger, qlog-decode renders the time.
+template <TimeFormat timeformat>
+struct Time {
+    using kind = detail::TimeKind;
+};
+// Default flushpolicy::Logfile.
+template <typename FlushPolicy>
+struct Flush {
+    using kind = detail::FlushKind;
+};
+// Default 1000, MultiQueueAsyncLogger only.
+template <unsigned int holdback>
+struct Holdback {
+    using kind = detail::HoldbackKind;
+};
+// Bytes of a string argument kept inline in its message, the rest spills into the slots after it. Default 0, what a message of msgsize
+// has room for, at most 240.
+template <std::size_t bytes>
+struct Capture {
+    using kind = detail::CaptureKind;
+};
+
+// Each setting at most once.
+template <typename... Settings>
+struct Options;
+
+template <>
+struct Options<> {
+    using StoragePolicy = container::storage::Inline;
+    static constexpr LogFile logfile = LogFile::Stream;
+    static constexpr TimeFormat timeformat = TimeFormat::Epoch;
+    using FlushPolicy = flushpolicy::Logfile;
+    static constexpr unsigned int holdback = 1000;
+    static constexpr std::size_t capture = 0;
+};
+
+template <typename StoragePolicy_, typename... Settings>
+struct Options<Storage<StoragePolicy_>, Settings...> : Options<Settings...> {
+    static_assert(std::is_base_of<container::storage::StoragePolicy, StoragePolicy_>::value, "Wrong Storage policy");
+    static_assert(!detail::given<detail::StorageKind, Settings...>::value, "options::Storage given twice");
+    using StoragePolicy = StoragePolicy_;
+};
+
+template <LogFile logfile_, typename... Settings>
+struct Options<File<logfile_>, Settings...> : Options<Settings...> {
+    static_assert(!detail::given<detail::FileKind, Settings...>::value, "options::File given twice");
+    static constexpr LogFile logfile = logfile_;
+};
+
+template <TimeFormat timeformat_, typename... Settings>
+struct Options<Time<timeformat_>, Settings...> : Options<Settings...> {
+    static_assert(!detail::given<detail::TimeKind, Settings...>::value, "options::Time given twice");
+    static constexpr TimeFormat timeformat = timeformat_;
+};
+
+template <typename FlushPolicy_, typename... Settings>
+struct Options<Flush<FlushPolicy_>, Settings...> : Options<Settings...> {
+    static_assert(std::is_base_of<flushpolicy::FlushPolicy, FlushPolicy_>::value, "Wrong Flush policy");
+    static_assert(!detail::given<detail::FlushKind, Settings...>::value, "options::Flush given twice");
+    using FlushPolicy = FlushPolicy_;
+};
+
+template <unsigned int holdback_, typename... Settings>
+struct Options<Holdback<holdback_>, Settings...> : Options<Settings...> {
+    static_assert(!detail::given<detail::HoldbackKind, Settings...>::value, "options::Holdback given twice");
+    static constexpr unsigned int holdback = holdback_;
+};
+
+template <std::size_t capture_, typename... Settings>
+struct Options<Capture<capture_>, Settings...> : Options<Settings...> {
+    static_assert(!detail::given<detail::CaptureKind, Settings...>::value, "options::Capture given twice");
+    static constexpr std::size_t capture = capture_;
+};
+}    // options end
+}    // logger end
+}    // common end
+#endif
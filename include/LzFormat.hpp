@@ -0,0 +1,233 @@
+#ifndef _LZ_FORMAT_HPP_
+#define _LZ_FORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+
+namespace common {
+namespace logger {
+namespace lz {
+// Block compression of LogFile::Lz, LZ77 with LZ4's block layout. A block is a sequence of:
+//   token: u8, literal count in the high nibble, match length - minMatch in the low one. 15 is continued by bytes added on, up to one below 255.
+//   [literal count continued] literals [u16 offset back from here] [match length continued]
+// The last sequence has literals only and ends the block. Matches may overlap what they produce.
+//
+// On disk a compressed log is a sequence of frames, each decodable on its own: FrameHeader, then stored bytes. Host endian, like binary logs.
+// A frame whose block didn't compress is stored as it is, storedSize == rawSize.
+
+static constexpr std::size_t minMatch = 4;
+static constexpr std::size_t maxOffset = 65535;
+static constexpr unsigned hashLog = 14;
+static constexpr std::size_t hashSize = std::size_t{1} << hashLog;
+static constexpr std::size_t maxBlockSize = 64 * 1024 * 1024;    // What a decoder accepts, anything larger is taken as garbage.
+
+static constexpr char magic[4] = {'Q', 'L', 'Z', 1};
+
+struct FrameHeader {
+    char magic[4];
+    std::uint32_t rawSize;
+    std::uint32_t storedSize;
+};
+
+// Worst case of compress(): all literals, with their count continued.
+constexpr std::size_t maxCompressedSize(std::size_t size) { return size + size / 255 + 16; }
+
+namespace detail {
+__attribute__((always_inline)) inline std::uint32_t read32(const unsigned char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+__attribute__((always_inline)) inline std::uint32_t hash(std::uint32_t v) { return (v * 2654435761u) >> (32 - hashLog); }
+
+__attribute__((always_inline)) inline unsigned char *putLength(unsigned char *op, std::size_t length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+}
+
+inline unsigned char *putSequence(unsigned char *op, const unsigned char *literals, std::size_t literalCount, std::size_t offset, std::size_t matchLength) {
+    const std::size_t matchCode = matchLength - minMatch;
+    unsigned char *token = op++;
+    *token = static_cast<unsigned char>((literalCount >= 15 ? 15 : literalCount) << 4 | (matchCode >= 15 ? 15 : matchCode));
+    if (literalCount >= 15) {
+        op = putLength(op, literalCount - 15);
+    }
+    std::memcpy(op, literals, literalCount);
+    op += literalCount;
+    *op++ = static_cast<unsigned char>(offset);
+    *op++ = static_cast<unsigned char>(offset >> 8);
+    if (matchCode >= 15) {
+        op = putLength(op, matchCode - 15);
+    }
+    return op;
+}
+
+inline std::size_t takeLength(const unsigned char *&ip, const unsigned char *end) {
+    std::size_t length = 0;
+    unsigned char b;
+    do {
+        if (ip == end) {
+            throw std::runtime_error{"Truncated compressed block"};
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return length;
+}
+}    // detail end
+
+// size bytes of src into dst, which has room for maxCompressedSize(size). Returns the compressed size.
+// table is hashSize entries of scratch, its contents don't matter: every block starts afresh.
+__attribute__((noinline)) inline std::size_t compress(const char *src, std::size_t size, char *dst, std::uint32_t *table) {
+    const auto base = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *const end = base + size;
+    unsigned char *op = reinterpret_cast<unsigned char *>(dst);
+
+    std::memset(table, 0, hashSize * sizeof(std::uint32_t));
+    if (size >= minMatch + 1) {
+        const unsigned char *const limit = end - minMatch;
+        while (ip < limit) {
+            const std::uint32_t seq = detail::read32(ip);
+            const auto h = detail::hash(seq);
+            const unsigned char *ref = base + table[h];
+            table[h] = static_cast<std::uint32_t>(ip - base);
+            if (ref >= ip || static_cast<std::size_t>(ip - ref) > maxOffset || detail::read32(ref) != seq) {
+                // Skip ahead faster the longer nothing matched.
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            // Back over literals that match as well.
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const unsigned char *mp = ip + minMatch;
+            const unsigned char *mr = ref + minMatch;
+            while (mp < end && *mp == *mr) {
+                ++mp;
+                ++mr;
+            }
+            op = detail::putSequence(op, anchor, ip - anchor, ip - ref, mp - ip);
+            ip = anchor = mp;
+            if (ip < limit) {
+                table[detail::hash(detail::read32(ip - 2))] = static_cast<std::uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+
+    const std::size_t literalCount = end - anchor;
+    *op++ = static_cast<unsigned char>((literalCount >= 15 ? 15 : literalCount) << 4);
+    if (literalCount >= 15) {
+        op = detail::putLength(op, literalCount - 15);
+    }
+    std::memcpy(op, anchor, literalCount);
+    op += literalCount;
+    return op - reinterpret_cast<unsigned char *>(dst);
+}
+
+// Into dst of exactly rawSize bytes. Throws on anything that is not a block of that size.
+inline void decompress(const char *src, std::size_t size, char *dst, std::size_t rawSize) {
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *const end = ip + size;
+    unsigned char *const out = reinterpret_cast<unsigned char *>(dst);
+    unsigned char *op = out;
+    unsigned char *const outEnd = out + rawSize;
+    while (true) {
+        if (ip == end) {
+            throw std::runtime_error{"Truncated compressed block"};
+        }
+        const unsigned token = *ip++;
+        std::size_t literalCount = token >> 4;
+        if (literalCount == 15) {
+            literalCount += detail::takeLength(ip, end);
+        }
+        if (static_cast<std::size_t>(end - ip) < literalCount || static_cast<std::size_t>(outEnd - op) < literalCount) {
+            throw std::runtime_error{"Corrupt compressed block"};
+        }
+        std::memcpy(op, ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            throw std::runtime_error{"Truncated compressed block"};
+        }
+        const std::size_t offset = ip[0] | static_cast<std::size_t>(ip[1]) << 8;
+        ip += 2;
+        std::size_t matchLength = (token & 15) + minMatch;
+        if ((token & 15) == 15) {
+            matchLength += detail::takeLength(ip, end);
+        }
+        if (offset == 0 || offset > static_cast<std::size_t>(op - out) || static_cast<std::size_t>(outEnd - op) < matchLength) {
+            throw std::runtime_error{"Corrupt compressed block"};
+        }
+        const unsigned char *match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping, a run of what was just written.
+            for (std::size_t i = 0; i < matchLength; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    if (op != outEnd) {
+        throw std::runtime_error{"Compressed block shorter than its frame says"};
+    }
+}
+
+// Frames back to the text, as they come. See decode().
+class FrameReader {
+   private:
+    std::unique_ptr<char[]> block;
+    std::size_t capacity;
+
+   public:
+    FrameReader() : block{}, capacity{0} {}
+
+    // One frame, starting at its header. Returns bytes consumed, 0 if more input is needed.
+    std::size_t decode(const char *data, std::size_t length, std::ostream &os) {
+        FrameHeader header;
+        if (length < sizeof(header)) {
+            return 0;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error{"Not a compressed log frame"};
+        }
+        if (header.rawSize > maxBlockSize || header.storedSize > maxCompressedSize(header.rawSize)) {
+            throw std::runtime_error{"Corrupt compressed log frame"};
+        }
+        if (length - sizeof(header) < header.storedSize) {
+            return 0;
+        }
+        const char *stored = data + sizeof(header);
+        if (header.storedSize == header.rawSize) {
+            os.write(stored, header.rawSize);
+        } else {
+            if (this->capacity < header.rawSize) {
+                this->block.reset(new char[header.rawSize]);
+                this->capacity = header.rawSize;
+            }
+            decompress(stored, header.storedSize, this->block.get(), header.rawSize);
+            os.write(this->block.get(), header.rawSize);
+        }
+        return sizeof(header) + header.storedSize;
+    }
+};
+
+}    // lz end
+}    // logger end
+}    // common end
+#endif
@@ -0,0 +1,141 @@
+#ifndef _LZ_LOGGER_HPP_
+#define _LZ_LOGGER_HPP_
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+#include "Logger.hpp"
+#include "LzFormat.hpp"
+
+namespace common {
+namespace logger {
+
+// Output buffer of LogFile::Lz. Text collects in a block, which is compressed into one frame and written once full, see LzFormat.hpp.
+// A flush writes what there is as a frame of its own, smaller ones compress worse. So due() only after maxDelay, otherwise frames are
+// whole blocks. All of it on the consumer, producers don't see it.
+class LzBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t frames;
+        std::uint64_t rawBytes;
+        std::uint64_t storedBytes;    // Headers included, what went to the file.
+        double ratio() const { return this->storedBytes ? static_cast<double>(this->rawBytes) / this->storedBytes : 0; }
+    };
+
+   private:
+    const int fd;
+    const std::size_t blockSize;
+    const std::chrono::microseconds maxDelay;
+    std::chrono::steady_clock::time_point lastWrite;
+    std::unique_ptr<char[]> block;
+    std::unique_ptr<char[]> frame;
+    std::unique_ptr<std::uint32_t[]> table;
+    std::atomic<std::uint64_t> frames;
+    std::atomic<std::uint64_t> rawBytes;
+    std::atomic<std::uint64_t> storedBytes;
+
+    // One frame of the block so far, in a single write.
+    void writeFrame() {
+        const auto size = static_cast<std::size_t>(this->pptr() - this->pbase());
+        this->lastWrite = std::chrono::steady_clock::now();
+        if (size == 0) {
+            return;
+        }
+        char *const stored = this->frame.get() + sizeof(lz::FrameHeader);
+        auto storedSize = lz::compress(this->pbase(), size, stored, this->table.get());
+        if (storedSize >= size) {
+            std::memcpy(stored, this->pbase(), size);
+            storedSize = size;
+        }
+        lz::FrameHeader header{{lz::magic[0], lz::magic[1], lz::magic[2], lz::magic[3]}, static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(storedSize)};
+        std::memcpy(this->frame.get(), &header, sizeof(header));
+        this->setp(this->block.get(), this->block.get() + this->blockSize);
+        writeAll(this->fd, this->frame.get(), sizeof(header) + storedSize);
+        this->frames.store(this->frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        this->rawBytes.store(this->rawBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+        this->storedBytes.store(this->storedBytes.load(std::memory_order_relaxed) + sizeof(header) + storedSize, std::memory_order_relaxed);
+    }
+
+   protected:
+    void writeOut() override { this->writeFrame(); }
+
+   public:
+    // maxDelay in microseconds.
+    LzBuffer(int fd_, std::size_t blockSize_, unsigned int maxDelay_)
+        : fd{fd_},
+          blockSize{blockSize_},
+          maxDelay{maxDelay_},
+          lastWrite{std::chrono::steady_clock::now()},
+          block{new char[blockSize_]},
+          frame{new char[sizeof(lz::FrameHeader) + lz::maxCompressedSize(blockSize_)]},
+          table{new std::uint32_t[lz::hashSize]},
+          frames{0},
+          rawBytes{0},
+          storedBytes{0} {
+        if (blockSize_ == 0 || blockSize_ > lz::maxBlockSize) {
+            throw std::invalid_argument{"Lz block size should be within lz::maxBlockSize"};
+        }
+        this->setp(this->block.get(), this->block.get() + this->blockSize);
+    }
+    LzBuffer(LzBuffer &&) = delete;
+    // Out of line, it is never hot.
+    __attribute__((noinline)) ~LzBuffer() {}
+
+    bool due() const { return this->pptr() != this->pbase() && std::chrono::steady_clock::now() - this->lastWrite >= this->maxDelay; }
+    Stats getStats() const {
+        return Stats{this->frames.load(std::memory_order_relaxed), this->rawBytes.load(std::memory_order_relaxed),
+                     this->storedBytes.load(std::memory_order_relaxed)};
+    }
+};
+
+// Compressed as it is written, in frames of blockSize text, see LzBuffer. Log text compresses several times over, so that much less goes
+// to the disk. tools/qlog-unlz gives back the text. Appending adds frames, a file is any number of them.
+template <>
+class Logger<LogFile::Lz> : public AbstractLogger {
+   public:
+    static constexpr std::size_t defaultBlockSize = 1024 * 1024;
+    static constexpr unsigned int defaultMaxDelay = 100000;
+
+   private:
+    UniqueFd fd;
+    LzBuffer buffer;
+
+   protected:
+    std::ostream file;
+    // maxDelay in microseconds.
+    Logger(std::string &&filename, std::size_t blockSize = defaultBlockSize, unsigned int maxDelay = defaultMaxDelay)
+        : fd{::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)}, buffer{this->fd.get(), blockSize, maxDelay}, file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() { this->close(); }
+    void check() {
+        if (this->fd.get() < 0) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    bool due() const { return this->buffer.due(); }
+    void close() {
+        if (this->fd.get() >= 0) {
+            this->flush();
+            this->fd.close();
+        }
+    }
+    std::ostream &getFile() { return this->file; }
+    LzBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+}    // logger end
+}    // common end
+#endif
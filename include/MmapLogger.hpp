@@ -0,0 +1,184 @@
+#ifndef _MMAP_LOGGER_HPP_
+#define _MMAP_LOGGER_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <system_error>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+
+// Output buffer of LogFile::Mmap: the put area is a window of the file itself, mapped shared. Bytes are copied straight into the page cache,
+// with no syscall until the window is full. Then the file is extended by another window (fallocate, or ftruncate where unsupported) and
+// that is mapped instead.
+// Writeback: every writeback bytes, writeback of what is new is started (sync_file_range), and what was started the time before is dropped
+// from the page cache, if it is clean by then. msync(MS_ASYNC) would do nothing on Linux.
+// The file is extended ahead of what is written, finish() truncates it back, on close() and after the crash drain. Only a process killed
+// outright leaves zeros up to the end of its last window, which stay: the file is appended to from its end, whatever it ends with.
+class MmapBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t windows;    // Mapped so far.
+        std::uint64_t writebacks;
+    };
+
+   private:
+    const int fd;
+    const std::size_t window;
+    const std::size_t writeback;
+    char *map;
+    std::uint64_t base;       // File offset of map, page aligned.
+    std::uint64_t started;    // Writeback started up to here.
+    std::uint64_t dropped;    // And dropped from the page cache up to here.
+    std::atomic<std::uint64_t> windows;
+    std::atomic<std::uint64_t> writebacks;
+
+    static void check(bool ok, const char *what) {
+        if (!ok) {
+            throw std::system_error{errno, std::generic_category(), what};
+        }
+    }
+
+    std::uint64_t position() const { return this->base + (this->pptr() - this->pbase()); }
+
+    // Rounded up to pages, one at least.
+    static std::size_t wholePages(std::size_t size) {
+        const std::size_t pagesize = sysconf(_SC_PAGESIZE);
+        return std::max((size + pagesize - 1) & ~(pagesize - 1), pagesize);
+    }
+
+    void mapAt(std::uint64_t offset) {
+        if (fallocate(this->fd, 0, offset, this->window) != 0) {
+            check(errno == EOPNOTSUPP && ftruncate(this->fd, offset + this->window) == 0, "Logfile extend");
+        }
+        void *mem = mmap(nullptr, this->window, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, offset);
+        check(mem != MAP_FAILED, "Logfile mmap");
+        this->map = static_cast<char *>(mem);
+        this->base = offset;
+        this->setp(this->map, this->map + this->window);
+        this->windows.store(this->windows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void unmap() {
+        if (this->map) {
+            munmap(this->map, this->window);
+            this->map = nullptr;
+        }
+    }
+
+   protected:
+    // On to the next window.
+    void writeOut() override {
+        this->unmap();
+        this->mapAt(this->base + this->window);
+    }
+
+    // Nothing to do for readers, the mapping is the page cache. Only writeback, see due().
+    void flushOut() override {
+        if (this->writeback == 0) {
+            return;
+        }
+        const std::uint64_t upto = this->position();
+        if (upto > this->started) {
+            sync_file_range(this->fd, this->started, upto - this->started, SYNC_FILE_RANGE_WRITE);
+            if (this->started > this->dropped) {
+                posix_fadvise(this->fd, this->dropped, this->started - this->dropped, POSIX_FADV_DONTNEED);
+                this->dropped = this->started;
+            }
+            this->started = upto;
+            this->writebacks.store(this->writebacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+   public:
+    // window is rounded up to whole pages. writeback = 0 leaves it all to the kernel.
+    MmapBuffer(int fd_, std::size_t window_, std::size_t writeback_)
+        : fd{fd_}, window{wholePages(window_)}, writeback{writeback_}, map{nullptr}, base{0}, started{0}, dropped{0}, windows{0}, writebacks{0} {
+        if (fd_ < 0) {
+            return;
+        }
+        struct stat st;
+        check(fstat(fd_, &st) == 0, "Logfile stat");
+        const std::uint64_t size = st.st_size;
+        const std::uint64_t offset = size & ~static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE) - 1);
+        this->mapAt(offset);
+        this->pbump(static_cast<int>(size - offset));
+        this->started = this->dropped = size;
+    }
+    ~MmapBuffer() { this->unmap(); }
+    MmapBuffer(MmapBuffer &&) = delete;
+
+    // Unmapped, and the file cut back to what was written.
+    void finish() {
+        if (this->map) {
+            const std::uint64_t size = this->position();
+            this->unmap();
+            this->setp(nullptr, nullptr);
+            check(ftruncate(this->fd, size) == 0, "Logfile truncate");
+        }
+    }
+
+    bool due() const { return this->writeback != 0 && this->position() - this->started >= this->writeback; }
+    Stats getStats() const { return Stats{this->windows.load(std::memory_order_relaxed), this->writebacks.load(std::memory_order_relaxed)}; }
+};
+
+// Formatted bytes go straight into a shared mapping of the file, see MmapBuffer. No write syscalls at all from the consumer, and one copy
+// less than a write(2). The file is only for this logger while it is open.
+template <>
+class Logger<LogFile::Mmap> : public AbstractLogger {
+   public:
+    static constexpr std::size_t defaultWindow = 64 * 1024 * 1024;
+    static constexpr std::size_t defaultWriteback = 8 * 1024 * 1024;
+
+   private:
+    UniqueFd fd;
+    MmapBuffer buffer;
+
+   protected:
+    std::ostream file;
+    Logger(std::string &&filename, std::size_t window = defaultWindow, std::size_t writeback = defaultWriteback)
+        : fd{::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)}, buffer{this->fd.get(), window, writeback}, file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() { this->close(); }
+    void check() {
+        if (this->fd.get() < 0) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    // The file cut back, the crash drain is the last write.
+    void settle() { this->buffer.finish(); }
+    bool due() const { return this->buffer.due(); }
+    void close() {
+        if (this->fd.get() >= 0) {
+            try {
+                this->buffer.finish();
+            } catch (const std::system_error &) {
+                this->file.setstate(std::ios::badbit);
+            }
+            this->fd.close();
+        }
+    }
+    std::ostream &getFile() { return this->file; }
+    MmapBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+}    // logger end
+}    // common end
+#endif
@@ -1,25 +1,128 @@
 #ifndef _MPSC_ASYNC_LOGGER_HPP_
 #define _MPSC_ASYNC_LOGGER_HPP_
 
+#include "MpscLockFreeQueue.hpp"
 #include "SafeAsyncLogger.hpp"
 
 namespace common {
 namespace logger {
-template <typename T, std::size_t...>
-queuelist {
-    using type = T;
+
+template <std::size_t msgsize, std::size_t size>
+class FixedMessageMpscLFQ : public container::MpscLockFreeQueue<msgsize, size> {
+    static_assert((msgsize & (msgsize - 1)) == 0, "msgsize should be power of 2");
+    static_assert((size & (size - 1)) == 0, "size should be power of 2");
+
+   protected:
+    using parent = container::MpscLockFreeQueue<msgsize, size>;
+
+   public:
+    static constexpr std::size_t maxSize() noexcept { return size; };
+    static constexpr std::size_t msgSize() noexcept { return msgsize; }
+
+    const Message *front() const { return static_cast<const Message *>(this->parent::front()); }
+
+    // What SafeAsyncLogger and the msgenqueuer get to see as the queue, one per log call.
+    // Slot offsets are relative to this producer's own claim instead of the shared tail.
+    class Producer {
+       private:
+        FixedMessageMpscLFQ &queue;
+        std::size_t pos;
+
+       public:
+        static constexpr std::size_t msgSize() noexcept { return msgsize; }
+
+        template <typename MsgList>
+        static constexpr std::size_t requiredSize() noexcept {
+            return std::tuple_size<MsgList>::value * msgsize;
+        }
+
+        explicit Producer(FixedMessageMpscLFQ &queue_) : queue{queue_}, pos{0} {}
+
+        // Unlike the spsc queue, a successful check also claims the space. Anything emplaced must be preceded by one.
+        __attribute__((always_inline)) inline bool canEnqueue(std::size_t requiredSize) {
+            return __builtin_expect(this->queue.reserve(requiredSize / msgsize, this->pos), 1);
+        }
+
+        template <typename T, typename... Args>
+        __attribute__((always_inline)) inline T *doOffsetEmplace(std::size_t offset, Args &&... args) {
+            return new (this->queue.at(this->pos + offset / msgsize)) T{std::forward<Args>(args)...};
+        }
+
+        __attribute__((always_inline)) void updateTail(std::size_t elemsize) { this->queue.publish(this->pos, elemsize / msgsize); }
+
+        std::size_t fillSize() const { return this->queue.fillSize(); }
+
+        // See spillBudget().
+        std::size_t spillRoom() const noexcept { return size / 2; }
+    };
 };
 
-template <typename... Qs, std::size_t msgsize, std::size_t maxmsgs, std::size_t... sz>
-    struct queuelist < std::tuple<Qs...> : queuelist < std::tuple<Qs..., LockFreeQueue<msgsize, maxmsgs>, sz...> {};
+// Options is an options::Options, see LoggerOptions.hpp.
+template <std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::Poll, typename WaitPolicy = waitpolicy::Sleep,
+          typename Options = options::Options<>>
+class MpscAsyncLogger : public SafeAsyncLogger<FixedMessageMpscLFQ<msgsize, (msgsize * maxmsgs)>, SafetyPolicy, WaitPolicy, Options::logfile, Options::timeformat,
+                                               typename Options::FlushPolicy, Options::capture> {
+   private:
+    static_assert(std::is_same<typename Options::StoragePolicy, container::storage::Inline>::value, "MpscLockFreeQueue has no StoragePolicy");
+    // Overwrite never claims slots, and the backup logger is written from the producer thread without any locking.
+    static_assert(!std::is_same<SafetyPolicy, safetypolicy::Overwrite>::value, "Overwrite policy not allowed with multiple producers");
+    static_assert(!safetypolicy::is_backuplog<SafetyPolicy>::value, "BackupLog policy not allowed with multiple producers");
+
+    using queue_t = FixedMessageMpscLFQ<msgsize, (msgsize * maxmsgs)>;
+
+    timestamp::MicroSecondTime lastTime;
+
+   protected:
+    using parent = SafeAsyncLogger<queue_t, SafetyPolicy, WaitPolicy, Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture>;
+
+   public:
+    static constexpr auto defaultDelim = ',';
+    static constexpr auto defaultEnd = '\n';
+
+    template <typename... Args>
+    MpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, lastTime{} {
+        this->file << "0.0,[INFO], LoggerInit, MaxMsgs=" << maxmsgs << ", QSize=" << msgsize * maxmsgs << ", MsgSize=" << msgsize << ", MPSC" << '\n';
+    }
+    virtual ~MpscAsyncLogger() = default;
+
+    // Safe to call concurrently from any number of threads.
+    template <typename labellist, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        typename queue_t::Producer producer{this->queue};
+        this->parent::template log<labellist, end, delim>(producer, std::forward<Args>(args)...);
+    }
+
+    // Through a format, see SpscAsyncLogger.
+    template <typename labellist, typename format, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        typename queue_t::Producer producer{this->queue};
+        this->parent::template log<label::Formatted<labellist, format>, end, delim>(producer, std::forward<Args>(args)...);
+    }
 
-template <std::size_t loggercount, char delim = ',', std::size_t... sz>
-class MultiQueueAsyncLogger : public Logger {
-    static_assert(sizeof(sz) % 2 == 0 && sizeof(sz) > 2 && sizeof(sz) / 2 == loggercount, "wrong number of arguments");
-    using qlist_t = queuelist<sz...>::type;
-    qlist_t qlist;
+    template <char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void lograw(Args &&... args) {
+        typename queue_t::Producer producer{this->queue};
+        this->parent::template lograw<end, delim>(producer, std::forward<Args>(args)...);
+    }
 
-    MultiQueueAsyncLogger(std::string &&filename) :
+    bool write() {
+        const bool wrote = !this->queue.empty();
+        while (!this->queue.empty()) {
+            const auto &msg = this->queue.front();
+            const auto &info = msg->getInfo();
+            this->flushing.record(info.level);
+            if (info.isTimed) {
+                if (info.hasTime) {
+                    this->lastTime = msg->getMicroSecondTime();
+                } else {
+                    this->out.write(this->lastTime);
+                }
+            }
+            msg->write(this->out);
+            this->queue.pop();
+        }
+        return wrote;
+    }
 };
 }
 }
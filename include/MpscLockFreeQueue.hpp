@@ -6,69 +6,75 @@
 
 namespace common {
 namespace container {
-template <std::size_t size>
-class LockFreeQueue {
+// Bounded multi producer, single consumer queue of fixed size slots.
+// Producers claim a contiguous run of slots by CAS on tail, construct into them and then publish each slot through its sequence number.
+// The consumer only ever looks at the slot under head and waits for its sequence to be published, hence drains strictly in claim order.
+// head and tail are monotonic slot counters (never masked), only the index into buffer is masked.
+template <std::size_t slotsize, std::size_t size>
+class MpscLockFreeQueue {
    private:
-    std::atomic<int> head;
-    // char head_padding[128];
-    std::atomic<int> tail;
-    // char tail_padding[128];
-    char buffer[size];
-    // char *buffer = new char[size];
-    // char buffer_padding[128];
+    static constexpr std::size_t slots = size / slotsize;
 
-    // protected:
-   public:
-    template <typename T>
-    __attribute__((always_inline)) void doPush(const T &arg) {
-        const T *storeAt = this->buffer + this->tail.load(std::memory_order_acquire);
-        *storeAt = arg;
-    }
+    std::atomic<std::size_t> head __attribute__((aligned(64)));
+    std::atomic<std::size_t> tail __attribute__((aligned(64)));
+    // sequence[i] == pos + 1 once the slot claimed at pos is fully constructed.
+    std::atomic<std::size_t> sequence[slots] __attribute__((aligned(64)));
+    char buffer[size] __attribute__((aligned(64)));
 
-    template <typename T, typename... Args>
-    __attribute__((always_inline)) void doEmplace(Args &&... args) {
-        new (this->buffer + this->tail.load(std::memory_order_acquire)) T{std::forward<Args>(args)...};
+   public:
+    MpscLockFreeQueue() : head{0}, tail{0} {
+        static_assert((slotsize & (slotsize - 1)) == 0, "slotsize should be power of 2");
+        static_assert((size & (size - 1)) == 0, "size should be power of 2");
+        static_assert(slots > 1, "size should hold more than one slot");
+        for (auto &seq : this->sequence) {
+            seq.store(0, std::memory_order_relaxed);
+        }
     }
-
-    template <typename T, typename... Args>
-    __attribute__((always_inline)) inline void doOffsetEmplace(std::size_t offset, Args &&... args) {
-        new (this->buffer + ((this->tail.load(std::memory_order_relaxed) + offset) & (size - 1))) T{std::forward<Args>(args)...};
+    ~MpscLockFreeQueue() {}
+    MpscLockFreeQueue(MpscLockFreeQueue &&) = delete;
+    MpscLockFreeQueue operator=(MpscLockFreeQueue &&) = delete;
+
+    // Producer side.
+    // Claims count consecutive slots starting at pos. Fails, without claiming anything, if they are not free.
+    __attribute__((always_inline)) inline bool reserve(std::size_t count, std::size_t &pos) {
+        pos = this->tail.load(std::memory_order_relaxed);
+        do {
+            // acquire: consumer must be done reading the slots before they are handed out again.
+            if (pos + count - this->head.load(std::memory_order_acquire) > slots) {
+                return false;
+            }
+        } while (!this->tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed, std::memory_order_relaxed));
+        return true;
     }
 
-    __attribute__((always_inline)) void updateTail(std::size_t elemsize) { this->tail = ((this->tail + elemsize) & (size - 1)); }
-
-    __attribute__((always_inline)) void updateHead(std::size_t elemsize) { this->head = ((this->head + elemsize) & (size - 1)); }
-
-   public:
-    LockFreeQueue() : head{0}, tail{0} { static_assert((size & (size - 1)) == 0, "size should be power of 2"); }
-    ~LockFreeQueue() {}
-    LockFreeQueue(LockFreeQueue &&) = delete;
-    LockFreeQueue operator=(LockFreeQueue &&) = delete;
+    __attribute__((always_inline)) inline void *at(std::size_t pos) { return this->buffer + (pos & (slots - 1)) * slotsize; }
 
-    template <typename T, typename... Args>
-    __attribute__((always_inline)) void emplace(Args &&... args) {
-        this->doEmplace<T>(std::forward<Args>(args)...);
-        this->updateTail(sizeof(T));
+    // Published back to front, so that once the consumer sees the first slot of a claim, the rest of it is visible as well.
+    __attribute__((always_inline)) inline void publish(std::size_t pos, std::size_t count) {
+        for (std::size_t i = count; i > 0; i--) {
+            this->sequence[(pos + i - 1) & (slots - 1)].store(pos + i, std::memory_order_release);
+        }
     }
 
-    template <typename T>
-    __attribute__((always_inline)) void push(const T &arg) {
-        this->doPush(arg);
-        this->updateTail(sizeof(T));
+    // Consumer side.
+    bool empty() const {
+        const auto h = this->head.load(std::memory_order_relaxed);
+        return this->sequence[h & (slots - 1)].load(std::memory_order_acquire) != h + 1;
     }
 
-    // This is just a guess.
-    std::size_t fillSize() const { return ((size + this->tail - this->head) & (size - 1)); }
+    const void *front() const { return this->buffer + (this->head.load(std::memory_order_relaxed) & (slots - 1)) * slotsize; }
 
-    bool empty() const { return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire); }
+    __attribute__((always_inline)) void pop() { this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
 
-    const void *front(int offset = 0) const { return this->buffer + ((this->head.load(std::memory_order_acquire) + offset) & (size - 1)); }
+    // Claimed, not necessarily published. This is just a guess as well.
+    std::size_t fillSize() const { return (this->tail.load(std::memory_order_relaxed) - this->head.load(std::memory_order_relaxed)) * slotsize; }
 
-    __attribute__((always_inline)) void pop(std::size_t popsize) { this->updateHead(popsize); }
+    // Storage is always inline here, nothing to do.
+    void prefault() {}
 
     // Exposed mostly for debugging. Shouldn't be required elsewhere.
-    int getHead(std::memory_order mo = std::memory_order_relaxed) const { return this->head.load(mo); }
-    int getTail(std::memory_order mo = std::memory_order_relaxed) const { return this->tail.load(mo); }
+    std::size_t getHead(std::memory_order mo = std::memory_order_relaxed) const { return this->head.load(mo); }
+    std::size_t getTail(std::memory_order mo = std::memory_order_relaxed) const { return this->tail.load(mo); }
 };
 }
 }
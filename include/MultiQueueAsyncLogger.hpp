@@ -3,7 +3,9 @@
 
 #include <algorithm>
 #include <array>
-#include <vector>
+#include <functional>
+#include <limits>
+#include <utility>
 
 #include "FstreamSyncLogger.hpp"
 #include "SafeAsyncLogger.hpp"
@@ -43,34 +45,120 @@ struct QId {
 // The complicacies increase manyfold when the list of queues can be of different types.
 // To be done later, to include support for differently sized queues.
 
-template <std::size_t count, std::size_t msgsize, std::size_t maxmsgs>
+template <std::size_t count, std::size_t msgsize, std::size_t maxmsgs, typename StoragePolicy = container::storage::Inline>
 struct QueueList {
-    using queue_t = FixedMessageLFQ<msgsize, (msgsize * maxmsgs)>;
+    using queue_t = FixedMessageLFQ<msgsize, (msgsize * maxmsgs), StoragePolicy>;
     std::array<queue_t, count> list;
     QueueList() {}
     queue_t &operator[](std::size_t i) { return list[i]; };
     const queue_t &operator[](std::size_t i) const { return list[i]; };
+    void prefault() {
+        for (auto &q : list) {
+            q.prefault();
+        }
+    }
+    std::size_t fillSize() const {
+        std::size_t size = 0;
+        for (auto &q : list) {
+            size += q.fillSize();
+        }
+        return size;
+    }
 };
 
-template <std::size_t loggercnt, std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>>
-class MultiQueueAsyncLogger : public SafeAsyncLogger<QueueList<loggercnt, msgsize, maxmsgs>, SafetyPolicy> {
+// Lines are merged across the queues by their time, see write(). Assumes each queue's times don't go backwards, ie. one producer per queue
+// logging the time it logs at. A queue that has gone quiet holds back lines later than holdback microseconds ago, as its producer could be
+// about to publish one from before them, holdback in options::Holdback. Options is an options::Options, see LoggerOptions.hpp.
+template <std::size_t loggercnt, std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>,
+          typename WaitPolicy = waitpolicy::Sleep, typename Options = options::Options<>>
+class MultiQueueAsyncLogger : public SafeAsyncLogger<QueueList<loggercnt, msgsize, maxmsgs, typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy, Options::logfile,
+                                                     Options::timeformat, typename Options::FlushPolicy, Options::capture> {
    private:
     static_assert(loggercnt == 1 || !std::is_same<SafetyPolicy, safetypolicy::Overwrite>::value, "Overwrite policy only allowed if loggercnt == 1 ");
 
-    using qlist_t = QueueList<loggercnt, msgsize, maxmsgs>;
+    using qlist_t = QueueList<loggercnt, msgsize, maxmsgs, typename Options::StoragePolicy>;
+    using time_t = timestamp::MicroSecondTime;
+    using integral_t = decltype(std::declval<time_t>().getIntegral());
+
+    // The record at the front of a queue: its first message and all after it up to the next one with a time of its own.
+    struct Head {
+        integral_t tm;
+        std::size_t qid;
 
-    struct MsgToWrite {
-        const Message *msg;
-        timestamp::MicroSecondTime tm;
-        std::size_t qid;    // qid is probably not required. This is deducible from the queue. Not done for now, due to complexity.
+        // Earliest on top of the heap, ties by queue.
+        bool operator>(const Head &rhs) const { return this->tm > rhs.tm || (this->tm == rhs.tm && this->qid > rhs.qid); }
     };
 
-    using time_t = decltype(MsgToWrite::tm);
-    std::vector<MsgToWrite> sortedmsgs;
-    std::array<time_t, loggercnt> lastTime;
+    std::array<Head, loggercnt> heads;
+    std::array<time_t, loggercnt> lastTime;    // Of the last message of each queue with a time, what those without one are written with.
 
    protected:
-    using parent = SafeAsyncLogger<QueueList<loggercnt, msgsize, maxmsgs>, SafetyPolicy>;
+    using parent = SafeAsyncLogger<qlist_t, SafetyPolicy, WaitPolicy, Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture>;
+
+   private:
+    // Time of the record at the front of queue i, which isn't empty.
+    integral_t headTime(std::size_t i) {
+        const auto &msg = this->queue[i].front();
+        if (msg->getInfo().hasTime) {
+            this->lastTime[i] = msg->getMicroSecondTime();
+        }
+        return this->lastTime[i].getIntegral();
+    }
+
+    // Writes and pops the record at the front of queue i, returns its number of messages.
+    std::size_t writeRecord(std::size_t i) {
+        auto &q = this->queue[i];
+        std::size_t msgs = 0;
+        do {
+            const auto &msg = q.front();
+            const auto &info = msg->getInfo();
+            this->flushing.record(info.level);
+            if (info.isTimed && !info.hasTime) {
+                this->out.write(this->lastTime[i]);
+            }
+            msg->write(this->out);
+            q.pop();
+            msgs++;
+        } while (!q.empty() && !(q.front()->getInfo().isTimed && q.front()->getInfo().hasTime));
+        return msgs;
+    }
+
+    // k-way merge of the queues' records on a heap of their heads, no more than a full set of queues' worth of messages.
+    // Records up to the watermark only, unless all: the earliest any quiet queue could still publish. None while every queue has a record.
+    bool merge(bool all) {
+        const integral_t now = time_t{}.getIntegral() - Options::holdback;
+        const auto quiet = [this, now](std::size_t i) { return std::max(this->lastTime[i].getIntegral(), now); };
+        auto watermark = std::numeric_limits<integral_t>::max();
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < loggercnt; i++) {
+            if (this->queue[i].empty()) {
+                watermark = std::min(watermark, quiet(i));
+            } else {
+                this->heads[count++] = Head{this->headTime(i), i};
+            }
+        }
+        const auto earliest = std::greater<Head>{};
+        std::make_heap(this->heads.begin(), this->heads.begin() + count, earliest);
+
+        bool wrote = false;
+        for (std::size_t msgs = 0; count > 0 && msgs < loggercnt * maxmsgs;) {
+            const Head head = this->heads.front();
+            if (!all && head.tm > watermark) {
+                break;
+            }
+            std::pop_heap(this->heads.begin(), this->heads.begin() + count, earliest);
+            count--;
+            msgs += this->writeRecord(head.qid);
+            wrote = true;
+            if (this->queue[head.qid].empty()) {
+                watermark = std::min(watermark, quiet(head.qid));
+            } else {
+                this->heads[count++] = Head{this->headTime(head.qid), head.qid};
+                std::push_heap(this->heads.begin(), this->heads.begin() + count, earliest);
+            }
+        }
+        return wrote;
+    }
 
    public:
     static constexpr auto defaultDelim = ',';
@@ -80,73 +168,67 @@ class MultiQueueAsyncLogger : public SafeAsyncLogger<QueueList<loggercnt, msgsiz
     // /Rant
     // Edit: This is apparently fixed in gcc5.1
     template <typename... Args>
-    MultiQueueAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, sortedmsgs{} {
+    MultiQueueAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, heads{}, lastTime{} {
         this->file << "0.0,[INFO], LoggerInit, MaxMsgs=" << maxmsgs << ", QSize=" << msgsize * maxmsgs << ", MsgSize=" << msgsize
                    << ", QCnt=" << loggercnt << '\n';
     }
     virtual ~MultiQueueAsyncLogger() = default;
 
+    // Scoped batch on one of the queues. See BasicSpscAsyncLogger::Batch.
+    template <typename qid>
+    class Batch {
+       private:
+        static_assert(qid::value < loggercnt, "Invalid QId");
+
+        MultiQueueAsyncLogger &logger;
+        BatchProducer<typename qlist_t::queue_t> producer;
+
+       public:
+        explicit Batch(MultiQueueAsyncLogger &logger_) : logger{logger_}, producer{logger_.queue[qid::value]} {}
+        ~Batch() {
+            this->producer.commit();
+            this->logger.waiter.notify();
+        }
+
+        template <typename labellist, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void log(Args &&... args) {
+            this->logger.parent::template log<labellist, end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+
+        template <typename labellist, typename format, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void log(Args &&... args) {
+            this->logger.parent::template log<label::Formatted<labellist, format>, end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+
+        template <char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void lograw(Args &&... args) {
+            this->logger.parent::template lograw<end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+    };
+
     template <typename labellist, typename qid, char end = defaultEnd, char delim = defaultDelim, typename... Args>
     __attribute__((always_inline)) inline void log(Args &&... args) {
         static_assert(qid::value < loggercnt, "Invalid QId");
         this->parent::template log<labellist, end, delim>(this->queue[qid::value], std::forward<Args>(args)...);
     }
 
+    // Through a format, see SpscAsyncLogger. The qid after it.
+    template <typename labellist, typename format, typename qid, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        static_assert(qid::value < loggercnt, "Invalid QId");
+        this->parent::template log<label::Formatted<labellist, format>, end, delim>(this->queue[qid::value], std::forward<Args>(args)...);
+    }
+
     template <typename qid, char end = defaultEnd, char delim = defaultDelim, typename... Args>
     __attribute__((always_inline)) inline void lograw(Args &&... args) {
         static_assert(qid::value < loggercnt, "Invalid QId");
         this->parent::template lograw<end, delim>(this->queue[qid::value], std::forward<Args>(args)...);
     }
 
-    void write() {
-        // This can be vastly improved.
-        for (std::size_t i = 0; i < loggercnt; i++) {
-            auto &q = this->queue[i];
-            std::size_t offset = 0;
-            const auto fillsize = q.fillSize();
-            while (offset < fillsize) {
-                const auto &msg = q.front(offset);
-                offset += msgsize;
-                const auto &info = msg->getInfo();
-                if (info.hasTime) {
-                    lastTime[i] = *static_cast<const time_t *>(msg->getTime());
-                    // sortedmsgs.emplace_back(&msg, lastTime[i], i);
-                    sortedmsgs.push_back(MsgToWrite{msg, lastTime[i], i});
-                } else if (offset == msgsize) {
-                    sortedmsgs.push_back(MsgToWrite{msg, lastTime[i], i});
-                }
-            }
-        }
-
-        std::sort(sortedmsgs.begin(), sortedmsgs.end(), [](const MsgToWrite &a, const MsgToWrite &b) { return a.tm < b.tm; });
+    bool write() { return this->merge(false); }
 
-        for (auto &msg : sortedmsgs) {
-            const auto &info = msg.msg->getInfo();
-            if (info.isTimed && !info.hasTime) {
-                this->file << msg.tm;
-            }
-            msg.msg->write(this->file);
-            this->queue[msg.qid].pop();
-            while (!this->queue[msg.qid].empty()) {
-                const auto &cmsg = this->queue[msg.qid].front();
-                const auto &cinfo = cmsg->getInfo();
-                if (cinfo.isTimed && cinfo.hasTime) {
-                    break;
-                } else {
-                    if (cinfo.isTimed) {
-                        this->file << msg.tm;
-                    }
-                    cmsg->write(this->file);
-                    this->queue[msg.qid].pop();
-                }
-            }
-            // Updating head everytime has a chance of everytime refilling the head-tail cacheline.
-            // But not updating head everytime might cause overflow.
-        }
-
-        // std::cerr << "fin" << std::endl;
-        sortedmsgs.clear();
-    }
+    // On stop and on a crash, nothing is held back.
+    bool writeAll() { return this->merge(true); }
 };
 }
 }
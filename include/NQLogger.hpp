@@ -3,8 +3,10 @@
 
 #include <FprintfSyncLogger.hpp>
 #include <FstreamSyncLogger.hpp>
+#include <MpscAsyncLogger.hpp>
 #include <MultiLogger.hpp>
 #include <MultiQueueAsyncLogger.hpp>
+#include <PerThreadAsyncLogger.hpp>
 #include <SpscAsyncLogger.hpp>
 
 namespace common {
@@ -29,9 +31,15 @@ using initlog_t = MultiLogger<FprintfSyncLogger &, FprintfSyncLogger, FullLevelL
 #define INITLOG(level, tag, args...) initLog.log<common::logger::label::LabelList<level, SCT(tag)>>(this->timeNow, ##args)
 #elif defined(_LOGGER_SETUP_MPSC_)
 #define MAINLOG(level, tag, args...) this->mainLog.log<common::logger::label::LabelList<level, SCT(tag)>>(MicroSecondTime{}, ##args)
-#define SENDLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[SEND]"), SCT(tag)>, common::logger::QId<0>>(args)
-#define RECVLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[RECV]"), SCT(tag)>, common::logger::QId<1>>(args)
-#define UPDTLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[UPDT]"), SCT(tag)>, common::logger::QId<2>>(args)
+#define SENDLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[SEND]"), SCT(tag)>>(args)
+#define RECVLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[RECV]"), SCT(tag)>>(args)
+#define UPDTLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[UPDT]"), SCT(tag)>>(args)
+#define INITLOG(level, tag, args...) initLog.log<common::logger::label::LabelList<level, SCT(tag)>>(this->timeNow, ##args)
+#elif defined(_LOGGER_SETUP_PERTHREAD_)
+#define MAINLOG(level, tag, args...) this->mainLog.log<common::logger::label::LabelList<level, SCT(tag)>>(MicroSecondTime{}, ##args)
+#define SENDLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[SEND]"), SCT(tag)>>(args)
+#define RECVLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[RECV]"), SCT(tag)>>(args)
+#define UPDTLOG(level, tag, args...) this->log.log<common::logger::label::LabelList<level, SCT("[UPDT]"), SCT(tag)>>(args)
 #define INITLOG(level, tag, args...) initLog.log<common::logger::label::LabelList<level, SCT(tag)>>(this->timeNow, ##args)
 #else
 #error message("Logger Setup Error")
@@ -0,0 +1,263 @@
+#ifndef _PER_THREAD_ASYNC_LOGGER_HPP_
+#define _PER_THREAD_ASYNC_LOGGER_HPP_
+
+#include <stdlib.h>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "SafeAsyncLogger.hpp"
+
+namespace common {
+namespace logger {
+
+// One spsc queue per producer thread, attached lazily on the thread's first log call.
+// Attaching pushes to the front of a lock free list. Only the consumer ever unlinks from it.
+// A node is freed by whichever side lets go of it last: the consumer once it is drained after its thread exited,
+// or the exiting thread if the list was destroyed first.
+template <typename queue_t>
+class ThreadQueueList {
+   public:
+    enum State : int { Live, Retired, Orphaned };
+
+    struct Node {
+        queue_t queue;
+        timestamp::MicroSecondTime lastTime;    // Consumer only.
+        std::atomic<int> state;
+        Node *next;    // Set before the node is published, only the consumer changes it after.
+
+        Node() : queue{}, lastTime{}, state{Live}, next{nullptr} {}
+    };
+
+   private:
+    struct Cache {
+        std::uint64_t owner;
+        Node *node;
+    };
+
+    // Node of each list this thread logged to, by the list's slot. Trivial, so that reading it is just a TLS load.
+    static constexpr std::size_t cacheSlots = 64;
+    static thread_local Cache cache[cacheSlots];
+
+    // Every node this thread holds, across lists. Retires them when the thread exits.
+    struct Holder {
+        std::vector<std::pair<std::uint64_t, Node *>> nodes;
+        ~Holder() {
+            for (auto &held : this->nodes) {
+                release(held.second, Retired);
+            }
+        }
+    };
+
+    static Holder &holder() {
+        static thread_local Holder h;
+        return h;
+    }
+
+    // Ids instead of addresses, a list constructed where a destroyed one was must not match a stale cache.
+    static std::uint64_t nextId() {
+        static std::atomic<std::uint64_t> ids{1};
+        return ids.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static std::atomic<std::uint64_t> &slotsInUse() {
+        static std::atomic<std::uint64_t> used{0};
+        return used;
+    }
+
+    // A cache slot of its own, while any are left. Lists beyond that share, and miss when a thread alternates between them.
+    static std::size_t claimSlot(std::uint64_t id, bool &owned) {
+        auto &used = slotsInUse();
+        auto bits = used.load(std::memory_order_relaxed);
+        while (~bits) {
+            const std::size_t slot = __builtin_ctzll(~bits);
+            if (used.compare_exchange_weak(bits, bits | (std::uint64_t{1} << slot), std::memory_order_relaxed)) {
+                owned = true;
+                return slot;
+            }
+        }
+        owned = false;
+        return id % cacheSlots;
+    }
+
+    static Node *make() {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, alignof(Node), sizeof(Node)) != 0) {
+            throw std::bad_alloc{};
+        }
+        return new (mem) Node{};
+    }
+
+    static void destroy(Node *node) {
+        node->~Node();
+        free(node);
+    }
+
+    static void release(Node *node, State to) {
+        if (node->state.exchange(to, std::memory_order_acq_rel) != Live) {
+            destroy(node);
+        }
+    }
+
+    const std::uint64_t id;
+    bool ownsSlot;
+    const std::size_t slot;
+    std::atomic<Node *> nodes;
+
+    __attribute__((noinline)) queue_t &attach() {
+        auto &held = holder().nodes;
+        Node *node = nullptr;
+        for (auto &h : held) {
+            if (h.first == this->id) {
+                node = h.second;
+            }
+        }
+        if (!node) {
+            node = make();
+            node->queue.prefault();
+            held.emplace_back(this->id, node);
+            node->next = this->nodes.load(std::memory_order_relaxed);
+            while (!this->nodes.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+                // Retry.
+            }
+        }
+        cache[this->slot] = Cache{this->id, node};
+        return node->queue;
+    }
+
+   public:
+    ThreadQueueList() : id{nextId()}, ownsSlot{false}, slot{claimSlot(this->id, this->ownsSlot)}, nodes{nullptr} {}
+    // The consumer must be stopped by now.
+    ~ThreadQueueList() {
+        auto node = this->nodes.load(std::memory_order_acquire);
+        while (node) {
+            const auto next = node->next;
+            release(node, Orphaned);
+            node = next;
+        }
+        if (this->ownsSlot) {
+            slotsInUse().fetch_and(~(std::uint64_t{1} << this->slot), std::memory_order_relaxed);
+        }
+    }
+    ThreadQueueList(ThreadQueueList &&) = delete;
+
+    // Producer side. The calling thread's own queue.
+    __attribute__((always_inline)) inline queue_t &local() {
+        const auto &cached = cache[this->slot];
+        if (__builtin_expect(cached.owner == this->id, 1)) {
+            return cached.node->queue;
+        }
+        return this->attach();
+    }
+
+    // Queues are prefaulted as they get attached, by their own thread.
+    void prefault() {}
+
+    // Consumer side. f(node) for every node. Nodes retired before f() that it left empty are unlinked and freed.
+    template <typename F>
+    void forEach(F &&f) {
+        Node *prev = nullptr;
+        auto node = this->nodes.load(std::memory_order_acquire);
+        while (node) {
+            const bool retired = node->state.load(std::memory_order_acquire) == Retired;
+            f(*node);
+            const auto next = node->next;
+            if (retired && node->queue.empty()) {
+                if (prev) {
+                    prev->next = next;
+                    destroy(node);
+                    node = next;
+                    continue;
+                }
+                // Head is shared with attach(). An ABA here is harmless, the attaching node links to whatever the head is.
+                auto expected = node;
+                if (this->nodes.compare_exchange_strong(expected, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    destroy(node);
+                    node = next;
+                    continue;
+                }
+            }
+            prev = node;
+            node = next;
+        }
+    }
+};
+
+template <typename queue_t>
+constexpr std::size_t ThreadQueueList<queue_t>::cacheSlots;
+template <typename queue_t>
+thread_local typename ThreadQueueList<queue_t>::Cache ThreadQueueList<queue_t>::cache[ThreadQueueList<queue_t>::cacheSlots];
+
+// Any number of producer threads, known only at runtime, each logging to its own spsc queue.
+// Lines are in order per thread, not across threads. Options is an options::Options, see LoggerOptions.hpp.
+template <std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::Poll, typename WaitPolicy = waitpolicy::Sleep,
+          typename Options = options::Options<>>
+class PerThreadAsyncLogger : public SafeAsyncLogger<ThreadQueueList<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>>, SafetyPolicy,
+                                                    WaitPolicy, Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture> {
+   private:
+    // The backup logger would be written from every producer thread without any locking.
+    static_assert(!safetypolicy::is_backuplog<SafetyPolicy>::value, "BackupLog policy not allowed with multiple producers");
+
+    using qlist_t = ThreadQueueList<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>>;
+
+    bool drain(typename qlist_t::Node &node) {
+        auto &q = node.queue;
+        const bool wrote = !q.empty();
+        while (!q.empty()) {
+            const auto &msg = q.front();
+            const auto &info = msg->getInfo();
+            this->flushing.record(info.level);
+            if (info.isTimed) {
+                if (info.hasTime) {
+                    node.lastTime = msg->getMicroSecondTime();
+                } else {
+                    this->out.write(node.lastTime);
+                }
+            }
+            msg->write(this->out);
+            q.pop();
+        }
+        return wrote;
+    }
+
+   protected:
+    using parent = SafeAsyncLogger<qlist_t, SafetyPolicy, WaitPolicy, Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture>;
+
+   public:
+    static constexpr auto defaultDelim = ',';
+    static constexpr auto defaultEnd = '\n';
+
+    template <typename... Args>
+    PerThreadAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...} {
+        this->file << "0.0,[INFO], LoggerInit, MaxMsgs=" << maxmsgs << ", QSize=" << msgsize * maxmsgs << ", MsgSize=" << msgsize << ", PerThread"
+                   << '\n';
+    }
+    virtual ~PerThreadAsyncLogger() = default;
+
+    template <typename labellist, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        this->parent::template log<labellist, end, delim>(this->queue.local(), std::forward<Args>(args)...);
+    }
+
+    // Through a format, see SpscAsyncLogger.
+    template <typename labellist, typename format, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        this->parent::template log<label::Formatted<labellist, format>, end, delim>(this->queue.local(), std::forward<Args>(args)...);
+    }
+
+    template <char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void lograw(Args &&... args) {
+        this->parent::template lograw<end, delim>(this->queue.local(), std::forward<Args>(args)...);
+    }
+
+    bool write() {
+        bool wrote = false;
+        this->queue.forEach([this, &wrote](typename qlist_t::Node &node) { wrote |= this->drain(node); });
+        return wrote;
+    }
+};
+}
+}
+#endif
@@ -0,0 +1,109 @@
+#ifndef _QUEUE_STORAGE_HPP_
+#define _QUEUE_STORAGE_HPP_
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <memory>
+#include <system_error>
+
+namespace common {
+namespace container {
+// As the size of a queue: capacity is then a constructor argument instead. See Capacity in LockFreeQueue.
+constexpr std::size_t dynamicSize = 0;
+
+namespace storage {
+// Where a queue keeps its buffer. type<size> is the buffer itself, owned by the queue, constructed with the actual capacity in bytes.
+// prefault() is called once from start(), before any producer gets to the queue.
+struct StoragePolicy {};
+
+// Buffer embedded in the queue, faulted in by whichever thread first writes to a page. What LockFreeQueue always did.
+struct Inline : StoragePolicy {
+    template <std::size_t size>
+    class type {
+        static_assert(size != dynamicSize, "Inline storage needs a fixed size");
+
+       private:
+        char buffer[size] __attribute__((aligned(64)));
+
+       public:
+        explicit type(std::size_t = size) {}
+
+        __attribute__((always_inline)) char *data() { return this->buffer; }
+        __attribute__((always_inline)) const char *data() const { return this->buffer; }
+        void prefault() {}
+    };
+};
+
+enum MappedFlags : unsigned {
+    HugePages = 1,        // MAP_HUGETLB, falling back to transparent huge pages if none are reserved.
+    Lock = 2,             // mlock, throws if not permitted, eg. over RLIMIT_MEMLOCK without CAP_IPC_LOCK. So not by default.
+    Prefault = 4,         // Write every page at start().
+    BindLocalNode = 8,    // mbind to the NUMA node of the thread calling start(), ideally the producer. Before prefault, so pages land there.
+};
+
+// Separately mmap'd buffer.
+template <unsigned flags = HugePages | Prefault>
+struct Mapped : StoragePolicy {
+    template <std::size_t size>
+    class type {
+       private:
+        static constexpr std::size_t pagesize = 4096;
+        static constexpr std::size_t hugepagesize = 2 * 1024 * 1024;
+
+        const std::size_t length;
+        char *buffer;
+
+        static void check(bool ok, const char *what) {
+            if (!ok) {
+                throw std::system_error{errno, std::generic_category(), what};
+            }
+        }
+
+       public:
+        explicit type(std::size_t bytes = size)
+            : length{(flags & HugePages) ? (bytes + hugepagesize - 1) & ~(hugepagesize - 1) : (bytes + pagesize - 1) & ~(pagesize - 1)}, buffer{nullptr} {
+            void *mem = MAP_FAILED;
+            if (flags & HugePages) {
+                mem = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+            if (mem == MAP_FAILED) {
+                mem = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                check(mem != MAP_FAILED, "Queue storage mmap");
+                if (flags & HugePages) {
+                    madvise(mem, this->length, MADV_HUGEPAGE);    // Only a hint, fine if THP is off.
+                }
+            }
+            this->buffer = static_cast<char *>(mem);
+        }
+        ~type() { munmap(this->buffer, this->length); }
+        type(const type &) = delete;
+        type &operator=(const type &) = delete;
+
+        __attribute__((always_inline)) char *data() { return this->buffer; }
+        __attribute__((always_inline)) const char *data() const { return this->buffer; }
+
+        void prefault() {
+            if (flags & BindLocalNode) {
+                unsigned int cpu = 0, node = 0;
+                check(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0, "Queue storage getcpu");
+                const unsigned long nodemask = 1ul << node;
+                check(syscall(SYS_mbind, this->buffer, this->length, MPOL_BIND, &nodemask, sizeof(nodemask) * 8, MPOL_MF_MOVE) == 0, "Queue storage mbind");
+            }
+            if (flags & Prefault) {
+                for (std::size_t i = 0; i < this->length; i += pagesize) {
+                    static_cast<volatile char *>(this->buffer)[i] = 0;
+                }
+            }
+            if (flags & Lock) {
+                check(mlock(this->buffer, this->length) == 0, "Queue storage mlock");
+            }
+        }
+    };
+};
+}    // storage end
+}    // container end
+}    // common end
+#endif
@@ -0,0 +1,281 @@
+#ifndef _ROTATING_LOGGER_HPP_
+#define _ROTATING_LOGGER_HPP_
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+
+// Output buffer of LogFile::Rotate. Buffered like FdBuffer, one write(2) once full or due, into filename. Rotated once that reaches
+// maxSize bytes, or at the next multiple of interval seconds since the epoch (UTC), whichever is set.
+// The next file is created ahead as filename.next, preallocated to maxSize. Rotating is then just switching to it: whole lines of the
+// buffer to the old file, the rest to the new one. A thread of its own renames the old file to filename.YYYYmmdd-HHMMSS.N, the next one
+// to filename, trims and closes the old one and creates the next next. If that isn't ready by the time it is due, rotation waits for it.
+class RotatingBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t rotations;
+        std::uint64_t late;    // Rotations put off for the next file.
+        int error;             // errno of a failed open or rename. Rotation stops after one, the current file is kept.
+    };
+
+   private:
+    const std::string filename;
+    const std::string nextname;
+    const std::size_t capacity;
+    const std::size_t threshold;
+    const std::uint64_t maxSize;
+    const std::uint64_t interval;
+    const std::chrono::microseconds maxDelay;
+    std::chrono::steady_clock::time_point lastWrite;
+    std::unique_ptr<char[]> buffer;
+    int fd;
+    std::uint64_t size;        // Of the current file.
+    std::uint64_t boundary;    // Seconds since the epoch of the next timed rotation.
+    bool waiting;              // Due, but next wasn't ready.
+    std::atomic<std::uint64_t> rotations;
+    std::atomic<std::uint64_t> late;
+
+    // With the rotator. next is only set by it, and only taken by the consumer under mutex, together with retiring.
+    std::atomic<int> next;
+    std::atomic<int> error;
+    std::mutex mutex;
+    std::condition_variable wake;
+    int retiring;
+    bool stopping;
+    std::thread rotator;
+
+    static std::uint64_t now() { return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()); }
+
+    std::uint64_t nextBoundary() const { return this->interval ? (now() / this->interval + 1) * this->interval : 0; }
+
+    bool rotationDue(std::size_t pending) const {
+        return (this->maxSize && this->size + pending >= this->maxSize) || (this->interval && now() >= this->boundary);
+    }
+
+    void write(const char *data, std::size_t length) {
+        this->size += length;
+        writeAll(this->fd, data, length);
+    }
+
+    void rotate() {
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->retiring = this->fd;
+            this->fd = this->next.exchange(-1);
+        }
+        this->wake.notify_one();
+        this->size = 0;
+        this->boundary = this->nextBoundary();
+        this->waiting = false;
+        this->rotations.store(this->rotations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void writeOut() override {
+        const char *begin = this->pbase();
+        const char *const end = this->pptr();
+        if (begin != end && this->rotationDue(end - begin)) {
+            const void *const newline = memrchr(begin, '\n', end - begin);
+            if (newline && this->next.load(std::memory_order_acquire) >= 0) {
+                const char *const cut = static_cast<const char *>(newline) + 1;
+                this->write(begin, cut - begin);
+                begin = cut;
+                this->rotate();
+            } else if (newline && !this->waiting) {
+                this->waiting = true;
+                this->late.store(this->late.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+        this->write(begin, end - begin);
+        this->setp(this->buffer.get(), this->buffer.get() + this->capacity);
+        this->lastWrite = std::chrono::steady_clock::now();
+    }
+
+    // Rotator thread from here. Never throws, errors go to error and stop further rotation.
+    void fail() { this->error.store(errno, std::memory_order_relaxed); }
+
+    void prepare() {
+        const int nextfd = ::open(this->nextname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (nextfd < 0) {
+            this->fail();
+            return;
+        }
+        // Blocks only, the size stays 0. Not every file system has it, then the file just grows as it is written.
+        if (this->maxSize) {
+            fallocate(nextfd, FALLOC_FL_KEEP_SIZE, 0, this->maxSize);
+        }
+        this->next.store(nextfd, std::memory_order_release);
+    }
+
+    void retire(int oldfd) {
+        char stamp[32];
+        const std::time_t seconds = std::time(nullptr);
+        struct tm tm;
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", gmtime_r(&seconds, &tm));
+        std::string archive;
+        for (unsigned seq = 1; archive.empty() || ::access(archive.c_str(), F_OK) == 0; seq++) {
+            archive = this->filename + '.' + stamp + '.' + std::to_string(seq);
+        }
+        // Renamed in this order, otherwise the old file would be replaced. If the first fails, the current file is still filename.next,
+        // so no next is made after it.
+        if (::rename(this->filename.c_str(), archive.c_str()) != 0 || ::rename(this->nextname.c_str(), this->filename.c_str()) != 0) {
+            this->fail();
+        }
+        // Whatever was preallocated and not written.
+        struct stat st;
+        if (fstat(oldfd, &st) == 0) {
+            ftruncate(oldfd, st.st_size);
+        }
+        ::close(oldfd);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{this->mutex};
+        while (true) {
+            if (this->retiring >= 0) {
+                const int oldfd = this->retiring;
+                this->retiring = -1;
+                lock.unlock();
+                this->retire(oldfd);
+                lock.lock();
+            } else if (this->stopping) {
+                break;
+            } else if (this->next.load(std::memory_order_relaxed) < 0 && !this->error.load(std::memory_order_relaxed)) {
+                lock.unlock();
+                this->prepare();
+                lock.lock();
+            } else {
+                this->wake.wait(lock);
+            }
+        }
+        const int nextfd = this->next.exchange(-1);
+        if (nextfd >= 0) {
+            ::close(nextfd);
+            ::unlink(this->nextname.c_str());
+        }
+    }
+
+   public:
+    // maxSize in bytes and interval in seconds, 0 for neither. maxDelay in microseconds.
+    RotatingBuffer(std::string filename_, std::uint64_t maxSize_, unsigned int interval_, std::size_t capacity_, std::size_t threshold_, unsigned int maxDelay_)
+        : filename{std::move(filename_)},
+          nextname{this->filename + ".next"},
+          capacity{capacity_},
+          threshold{threshold_},
+          maxSize{maxSize_},
+          interval{interval_},
+          maxDelay{maxDelay_},
+          lastWrite{std::chrono::steady_clock::now()},
+          buffer{new char[capacity_]},
+          fd{::open(this->filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)},
+          size{0},
+          boundary{this->nextBoundary()},
+          waiting{false},
+          rotations{0},
+          late{0},
+          next{-1},
+          error{0},
+          retiring{-1},
+          stopping{false},
+          rotator{} {
+        if (this->capacity == 0 || this->threshold > this->capacity) {
+            this->close();
+            throw std::invalid_argument{"Rotate buffer threshold should be within its size"};
+        }
+        struct stat st;
+        if (this->fd >= 0 && fstat(this->fd, &st) == 0) {
+            this->size = st.st_size;
+        }
+        this->setp(this->buffer.get(), this->buffer.get() + this->capacity);
+        if (this->fd >= 0 && (this->maxSize || this->interval)) {
+            this->rotator = std::thread{&RotatingBuffer::run, this};
+        }
+    }
+    ~RotatingBuffer() {
+        if (this->rotator.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock{this->mutex};
+                this->stopping = true;
+            }
+            this->wake.notify_one();
+            this->rotator.join();
+        }
+        this->close();
+    }
+    RotatingBuffer(RotatingBuffer &&) = delete;
+
+    bool good() const { return this->fd >= 0; }
+    void close() {
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+    bool due() const {
+        const auto pending = static_cast<std::size_t>(this->pptr() - this->pbase());
+        return pending >= this->threshold || (pending != 0 && std::chrono::steady_clock::now() - this->lastWrite >= this->maxDelay);
+    }
+    Stats getStats() const {
+        return Stats{this->rotations.load(std::memory_order_relaxed), this->late.load(std::memory_order_relaxed), this->error.load(std::memory_order_relaxed)};
+    }
+};
+
+// LogFile::Fd that rotates itself, see RotatingBuffer. All of it on the consumer or the rotator thread, producers never see a rotation.
+// Replaces copytruncate and restarts: the file is never truncated under the writer, filename is always the current one.
+template <>
+class Logger<LogFile::Rotate> : public AbstractLogger {
+   public:
+    static constexpr std::uint64_t defaultMaxSize = 256 * 1024 * 1024;
+    static constexpr std::size_t defaultBufferSize = 1024 * 1024;
+    static constexpr unsigned int defaultMaxDelay = 1000;
+
+   private:
+    RotatingBuffer buffer;
+
+   protected:
+    std::ostream file;
+    // interval in seconds, eg. 86400 for daily at midnight UTC. threshold = 0 is half the buffer, maxDelay in microseconds.
+    Logger(std::string &&filename, std::uint64_t maxSize = defaultMaxSize, unsigned int interval = 0, std::size_t bufferSize = defaultBufferSize,
+           std::size_t threshold = 0, unsigned int maxDelay = defaultMaxDelay)
+        : buffer{std::move(filename), maxSize, interval, bufferSize, threshold ? threshold : bufferSize / 2, maxDelay}, file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() {
+        this->flush();
+        this->close();
+    }
+    void check() {
+        if (!this->buffer.good()) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    bool due() const { return this->buffer.due(); }
+    void close() { this->buffer.close(); }
+    std::ostream &getFile() { return this->file; }
+    RotatingBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+}    // logger end
+}    // common end
+#endif
@@ -8,24 +8,24 @@ namespace logger {
 namespace safetypolicy {
 struct SafetyPolicy {};
 struct Ignore : public SafetyPolicy {
-    template <std::size_t requiredSize, typename Q>
-    static __attribute__((always_inline)) inline bool execute(Q &q) {
+    template <typename Q>
+    static __attribute__((always_inline)) inline bool execute(Q &q, std::size_t requiredSize) {
         // Do nothing.
         return false;
     }
 };
 
 struct Overwrite : public SafetyPolicy {
-    template <std::size_t requiredSize, typename Q>
-    static __attribute__((always_inline)) inline bool execute(Q &q) {
+    template <typename Q>
+    static __attribute__((always_inline)) inline bool execute(Q &q, std::size_t requiredSize) {
         // Allow Overwrite.
         return true;
     }
 };
 
 struct Poll : public SafetyPolicy {
-    template <std::size_t requiredSize, typename Q>
-    static __attribute__((always_inline)) inline bool execute(Q &q) {
+    template <typename Q>
+    static __attribute__((always_inline)) inline bool execute(Q &q, std::size_t requiredSize) {
         while (!q.canEnqueue(requiredSize)) {
             // Spin.
         }
@@ -36,15 +36,21 @@ struct Poll : public SafetyPolicy {
 template <typename Logger_t>
 struct BackupLog : public SafetyPolicy {};
 
+template <typename T>
+struct is_backuplog : std::false_type {};
+template <typename Logger_t>
+struct is_backuplog<BackupLog<Logger_t>> : std::true_type {};
+
 }    // safetypolicy end
 
-template <typename queue_t, typename SafetyPolicy>
-class SafeAsyncLogger : public AsyncLogger<queue_t> {
+template <typename queue_t, typename SafetyPolicy, typename WaitPolicy = waitpolicy::Sleep, LogFile logfile = LogFile::Stream, TimeFormat timeformat = TimeFormat::Epoch, typename FlushPolicy = flushpolicy::Logfile,
+          std::size_t capture = 0>
+class SafeAsyncLogger : public AsyncLogger<queue_t, WaitPolicy, logfile, timeformat, FlushPolicy, capture> {
    private:
     static_assert(std::is_base_of<safetypolicy::SafetyPolicy, SafetyPolicy>::value, "Wrong Safety policy");
 
    protected:
-    using parent = AsyncLogger<queue_t>;
+    using parent = AsyncLogger<queue_t, WaitPolicy, logfile, timeformat, FlushPolicy, capture>;
 
     template <typename... Args>
     SafeAsyncLogger(Args &&... args) : parent(std::forward<Args>(args)...) {}
@@ -52,27 +58,37 @@ class SafeAsyncLogger : public AsyncLogger<queue_t> {
 
     template <typename labellist, char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void log(Q &q, Args &&... args) {
+        // Held while a crash drain has the queues, see CrashHandler.hpp.
+        if (__builtin_expect(crash::holding(), 0)) {
+            crash::hold();
+        }
         // __builtin_expect because this is most probably going to be true.
-        if (SafetyPolicy::template execute<parent::template getRequiredSize<Q::msgSize(), labellist, end, delim, Args...>()>(q)) {
+        const std::size_t required = parent::template getRequiredSize<Q, labellist, end, delim, Args...>() + parent::template getSpillSize<Q, Args...>(q, args...);
+        if (SafetyPolicy::execute(q, required)) {
             this->parent::template log<labellist, end, delim>(q, std::forward<Args>(args)...);
         }
     }
 
     template <char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void lograw(Q &q, Args &&... args) {
-        if (SafetyPolicy::template execute<parent::template getRequiredSize<Q::msgSize(), end, delim, Args...>()>(q)) {
+        if (__builtin_expect(crash::holding(), 0)) {
+            crash::hold();
+        }
+        const std::size_t required = parent::template getRequiredSize<Q, end, delim, Args...>() + parent::template getSpillSize<Q, Args...>(q, args...);
+        if (SafetyPolicy::execute(q, required)) {
             this->parent::template lograw<end, delim>(q, std::forward<Args>(args)...);
         }
     }
 };
 
-template <typename queue_t, typename L>
-class SafeAsyncLogger<queue_t, safetypolicy::BackupLog<L>> : public AsyncLogger<queue_t> {
+template <typename queue_t, typename L, typename WaitPolicy, LogFile logfile, TimeFormat timeformat, typename FlushPolicy, std::size_t capture>
+class SafeAsyncLogger<queue_t, safetypolicy::BackupLog<L>, WaitPolicy, logfile, timeformat, FlushPolicy, capture>
+    : public AsyncLogger<queue_t, WaitPolicy, logfile, timeformat, FlushPolicy, capture> {
    private:
     L backupLogger;
 
    protected:
-    using parent = AsyncLogger<queue_t>;
+    using parent = AsyncLogger<queue_t, WaitPolicy, logfile, timeformat, FlushPolicy, capture>;
 
     template <typename T, typename... Args>
     SafeAsyncLogger(T &&filename, Args &&... args) : parent{std::forward<Args>(args)...}, backupLogger{std::forward<T>(filename)} {}
@@ -81,21 +97,28 @@ class SafeAsyncLogger<queue_t, safetypolicy::BackupLog<L>> : public AsyncLogger<
 
     template <typename labellist, char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void log(Q &q, Args &&... args) {
-        if (q.canEnqueue(parent::template getRequiredSize<Q::msgSize(), labellist, end, delim, Args...>())) {
+        if (__builtin_expect(crash::holding(), 0)) {
+            crash::hold();
+        }
+        const std::size_t required = parent::template getRequiredSize<Q, labellist, end, delim, Args...>() + parent::template getSpillSize<Q, Args...>(q, args...);
+        if (q.canEnqueue(required)) {
             this->parent::template log<labellist, end, delim>(q, std::forward<Args>(args)...);
         } else {
             // Do something here before backing up??
             // Ideally error msg to be added at the end of args. Because scripts would work on csv columns of fields.
             // Extra field may not hurt but shifted fields would hurt badly
             this->backupLogger.template log<labellist, end, delim>(std::forward<Args>(args)..., "[ALOG_ERR]", "Buffer Overflow",
-                                                                   parent::template getRequiredSize<Q::msgSize(), labellist, end, delim, Args...>(),
-                                                                   q.fillSize());
+                                                                   required, q.fillSize());
         }
     }
 
     template <char end, char delim, typename Q, typename... Args>
     __attribute__((always_inline)) inline void lograw(Q &q, Args &&... args) {
-        if (q.canEnqueue(parent::template getRequiredSize<Q::msgSize(), end, delim, Args...>())) {
+        if (__builtin_expect(crash::holding(), 0)) {
+            crash::hold();
+        }
+        const std::size_t required = parent::template getRequiredSize<Q, end, delim, Args...>() + parent::template getSpillSize<Q, Args...>(q, args...);
+        if (q.canEnqueue(required)) {
             this->parent::template lograw<end, delim>(q, std::forward<Args>(args)...);
         } else {
             // This needs to be a check on fillvsmax.
@@ -103,8 +126,7 @@ class SafeAsyncLogger<queue_t, safetypolicy::BackupLog<L>> : public AsyncLogger<
             // Can't make assumptions about what is going to be logged here.
             // The most I can do is provide own timestamp with a identifier sayin it's a raw message.
             this->backupLogger.template lograw<end, delim>(timestamp::MicroSecondTime{}, "RAW", std::forward<Args>(args)..., "[ALOG_ERR]",
-                                                           "Buffer Overflow", parent::template getRequiredSize<Q::msgSize(), end, delim, Args...>(),
-                                                           q.fillSize());
+                                                           "Buffer Overflow", required, q.fillSize());
         }
     }
 };
@@ -7,53 +7,183 @@
 namespace common {
 namespace logger {
 
-template <std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>>
-class SpscAsyncLogger : public SafeAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs)>, SafetyPolicy> {
+// Single producer logger over any of the spsc message queues, FixedMessageLFQ or VariableMessageLFQ.
+template <typename queue_t, typename SafetyPolicy, typename WaitPolicy, LogFile logfile = LogFile::Stream, TimeFormat timeformat = TimeFormat::Epoch, typename FlushPolicy = flushpolicy::Logfile,
+          std::size_t capture = 0>
+class BasicSpscAsyncLogger : public SafeAsyncLogger<queue_t, SafetyPolicy, WaitPolicy, logfile, timeformat, FlushPolicy, capture> {
    private:
     timestamp::MicroSecondTime lastTime;
 
    protected:
-    using parent = SafeAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs)>, SafetyPolicy>;
+    using parent = SafeAsyncLogger<queue_t, SafetyPolicy, WaitPolicy, logfile, timeformat, FlushPolicy, capture>;
+
+    template <typename... Args>
+    BasicSpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, lastTime{} {}
+    virtual ~BasicSpscAsyncLogger() = default;
 
    public:
     static constexpr auto defaultDelim = ',';
     static constexpr auto defaultEnd = '\n';
 
-    template <typename... Args>
-    SpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, lastTime{} {
-        this->file << "0.0,[INFO], LoggerInit, MaxMsgs=" << maxmsgs << ", QSize=" << msgsize * maxmsgs << ", MsgSize=" << msgsize << '\n';
-    }
-    virtual ~SpscAsyncLogger() = default;
+    // Scoped batch. Same log/lograw as the logger, but the consumer sees nothing till the batch is destroyed.
+    // Only from the producer thread, and the logger must not be used directly while a batch is alive.
+    class Batch {
+       private:
+        BasicSpscAsyncLogger &logger;
+        BatchProducer<queue_t> producer;
+
+       public:
+        explicit Batch(BasicSpscAsyncLogger &logger_) : logger{logger_}, producer{logger_.queue} {}
+        ~Batch() {
+            this->producer.commit();
+            this->logger.waiter.notify();
+        }
+
+        template <typename labellist, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void log(Args &&... args) {
+            this->logger.parent::template log<labellist, end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+
+        template <typename labellist, typename format, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void log(Args &&... args) {
+            this->logger.parent::template log<label::Formatted<labellist, format>, end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+
+        template <char end = defaultEnd, char delim = defaultDelim, typename... Args>
+        __attribute__((always_inline)) inline void lograw(Args &&... args) {
+            this->logger.parent::template lograw<end, delim>(this->producer, std::forward<Args>(args)...);
+        }
+    };
 
     template <typename labellist, char end = defaultEnd, char delim = defaultDelim, typename... Args>
     __attribute__((always_inline)) inline void log(Args &&... args) {
         this->parent::template log<labellist, end, delim>(this->queue, std::forward<Args>(args)...);
     }
 
+    // Written as format has it, eg. log<labellist, SCT("fill {} @ {} qty={}")>(time, price, side, qty). Time, labels delimited as usual,
+    // then the literals of format with the arguments in place of its {}. The literals are only in the type, messages keep just the arguments.
+    template <typename labellist, typename format, char end = defaultEnd, char delim = defaultDelim, typename... Args>
+    __attribute__((always_inline)) inline void log(Args &&... args) {
+        this->parent::template log<label::Formatted<labellist, format>, end, delim>(this->queue, std::forward<Args>(args)...);
+    }
+
     template <char end = defaultEnd, char delim = defaultDelim, typename... Args>
     __attribute__((always_inline)) inline void lograw(Args &&... args) {
         this->parent::template lograw<end, delim>(this->queue, std::forward<Args>(args)...);
     }
 
-    void write() {
+    bool write() {
+        const bool wrote = !this->queue.empty();
         while (!this->queue.empty()) {
             const auto &msg = this->queue.front();
             const auto &info = msg->getInfo();
+            this->flushing.record(info.level);
             if (info.isTimed) {
                 if (info.hasTime) {
-                    // There is no guarantee that this cast is even valid.
-                    // This looks very very shady and dirty, but dirty deeds cause for dirty methods.
-                    // This needs to be made optional through template specialization/inheritance etc...
-                    this->lastTime = *(static_cast<const decltype(lastTime) *>(msg->getTime()));
-                    // Requires some kind of RTTI. like maybe taking address ot time::set to uniquely identify type and storing in msginfo.
+                    // Converted from whatever time type the message has, eg. TscTime.
+                    this->lastTime = msg->getMicroSecondTime();
                 } else {
-                    this->file << this->lastTime;
+                    this->out.write(this->lastTime);
                 }
             }
-            msg->write(this->file);
+            msg->write(this->out);
             this->queue.pop();
         }
+        return wrote;
+    }
+};
+
+// maxmsgs = container::dynamicSize: queue capacity in bytes is the last constructor argument, after microsleep. Needs a non Inline
+// options::Storage. Options is an options::Options, see LoggerOptions.hpp.
+template <std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>,
+          typename WaitPolicy = waitpolicy::Sleep, typename Options = options::Options<>>
+class SpscAsyncLogger : public BasicSpscAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy,
+                                                    Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture> {
+   protected:
+    using parent = BasicSpscAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy, Options::logfile,
+                                        Options::timeformat, typename Options::FlushPolicy, Options::capture>;
+
+   public:
+    template <typename... Args>
+    SpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...} {
+        this->file << "0.0,[INFO], LoggerInit, MaxMsgs=" << this->queue.capacity() / msgsize << ", QSize=" << this->queue.capacity()
+                   << ", MsgSize=" << msgsize << '\n';
+    }
+    virtual ~SpscAsyncLogger() = default;
+};
+
+// SpscAsyncLogger writing the binary format instead of text, see BinaryFormat.hpp. qlog-decode turns the file back into the same csv.
+template <std::size_t msgsize, std::size_t maxmsgs, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>,
+          typename WaitPolicy = waitpolicy::Sleep, typename Options = options::Options<>>
+class BinarySpscAsyncLogger : public BasicSpscAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy,
+                                                          Options::logfile, TimeFormat::Epoch, typename Options::FlushPolicy, Options::capture> {
+   private:
+    static_assert(Options::timeformat == TimeFormat::Epoch, "Binary logs keep the epoch time, qlog-decode renders it");
+
+    // Encoded records are written out at least every this many bytes.
+    static constexpr std::size_t drainSize = 64 * 1024;
+
+    timestamp::MicroSecondTime lastTime;
+    binary::Encoder encoder;
+
+   protected:
+    using parent = BasicSpscAsyncLogger<FixedMessageLFQ<msgsize, (msgsize * maxmsgs), typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy, Options::logfile,
+                                        TimeFormat::Epoch, typename Options::FlushPolicy, Options::capture>;
+
+   public:
+    template <typename... Args>
+    BinarySpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...}, lastTime{} {
+        std::ostringstream init;
+        init << "0.0,[INFO], LoggerInit, MaxMsgs=" << this->queue.capacity() / msgsize << ", QSize=" << this->queue.capacity() << ", MsgSize=" << msgsize
+             << '\n';
+        this->encoder.session(init.str());
+        this->out.account(this->encoder.drainTo(this->file));
+    }
+    virtual ~BinarySpscAsyncLogger() = default;
+
+    // Left out of a crash drain, see CrashHandler.hpp: encoding allocates, for a new message type or a record past the buffer.
+    bool drainOnCrash() override { return false; }
+
+    bool write() {
+        const bool wrote = !this->queue.empty();
+        while (!this->queue.empty()) {
+            const auto &msg = this->queue.front();
+            const auto &info = msg->getInfo();
+            this->flushing.record(info.level);
+            const timestamp::MicroSecondTime *prefix = nullptr;
+            if (info.isTimed) {
+                if (info.hasTime) {
+                    this->lastTime = msg->getMicroSecondTime();
+                } else {
+                    prefix = &this->lastTime;
+                }
+            }
+            msg->encode(this->encoder, prefix);
+            this->queue.pop();
+            if (this->encoder.size() >= drainSize) {
+                this->out.account(this->encoder.drainTo(this->file));
+            }
+        }
+        this->out.account(this->encoder.drainTo(this->file));
+        return wrote;
+    }
+};
+
+// No msgsize to tune, each message takes its own size in the queue. See VariableMessageLFQ. size can be container::dynamicSize as above.
+template <std::size_t size, typename SafetyPolicy = safetypolicy::BackupLog<FstreamSyncLogger>, typename WaitPolicy = waitpolicy::Sleep,
+          std::size_t maxmsgsize = 1024, typename Options = options::Options<>>
+class VariableSpscAsyncLogger : public BasicSpscAsyncLogger<VariableMessageLFQ<size, maxmsgsize, typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy,
+                                                            Options::logfile, Options::timeformat, typename Options::FlushPolicy, Options::capture> {
+   protected:
+    using parent = BasicSpscAsyncLogger<VariableMessageLFQ<size, maxmsgsize, typename Options::StoragePolicy>, SafetyPolicy, WaitPolicy, Options::logfile,
+                                        Options::timeformat, typename Options::FlushPolicy, Options::capture>;
+
+   public:
+    template <typename... Args>
+    VariableSpscAsyncLogger(Args &&... args) : parent{std::forward<Args>(args)...} {
+        this->file << "0.0,[INFO], LoggerInit, QSize=" << this->queue.capacity() << ", MaxMsgSize=" << maxmsgsize << ", VariableMsg" << '\n';
     }
+    virtual ~VariableSpscAsyncLogger() = default;
 };
 }
 }
@@ -5,6 +5,11 @@
 // CT("ABCD") will be equivalent to common::stringct::StringCT<'A','B','C','D'>
 // supports upto 17 characters
 
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 namespace common {
 namespace stringct {
 
@@ -89,6 +94,54 @@ struct DelimitConcatStringCT<D, T> : T {};
 template <typename D, typename T, typename U, typename... Args>
 struct DelimitConcatStringCT<D, T, U, Args...> : ConcatStringCT<T, D, typename DelimitConcatStringCT<D, U, Args...>::type> {};
 
+// "fill {} @ {} qty={}" taken apart at compile time: Segments are the literals around the {} placeholders, one more than there are of them.
+// {{ and }} for literal braces, any other brace is an error. As long as SCT takes, ie. 64 characters.
+template <typename... Segments>
+struct FormatCT {
+    static constexpr std::size_t placeholders = sizeof...(Segments) - 1;
+    static constexpr std::size_t lengths[sizeof...(Segments)] = {(sizeof(Segments::str) - 1)...};
+
+    template <std::size_t i>
+    using segment = typename std::tuple_element<i, std::tuple<Segments...>>::type;
+
+    // Of the segments from up to to.
+    static constexpr std::size_t length(std::size_t from, std::size_t to) { return from < to ? lengths[from] + length(from + 1, to) : 0; }
+};
+
+template <typename... Segments>
+constexpr std::size_t FormatCT<Segments...>::lengths[sizeof...(Segments)];
+
+template <typename Done, char c>
+struct UnmatchedBraceCT {
+    static_assert(!std::is_same<Done, Done>::value, "Unmatched brace in format, {{ and }} for literal ones");
+    using type = FormatCT<>;
+};
+
+template <typename Done, typename Current, char... chars>
+struct ParseFormatCT;
+template <typename... Done, char... cur>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>> : FormatCT<Done..., StringCT<cur...>> {
+    using type = FormatCT<Done..., StringCT<cur...>>;
+};
+template <typename... Done, char... cur, char c, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, c, chars...> : ParseFormatCT<FormatCT<Done...>, StringCT<cur..., c>, chars...> {};
+template <typename... Done, char... cur, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, '{', '}', chars...> : ParseFormatCT<FormatCT<Done..., StringCT<cur...>>, StringCT<>, chars...> {};
+template <typename... Done, char... cur, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, '{', '{', chars...> : ParseFormatCT<FormatCT<Done...>, StringCT<cur..., '{'>, chars...> {};
+template <typename... Done, char... cur, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, '}', '}', chars...> : ParseFormatCT<FormatCT<Done...>, StringCT<cur..., '}'>, chars...> {};
+template <typename... Done, char... cur, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, '{', chars...> : UnmatchedBraceCT<FormatCT<Done...>, '{'> {};
+template <typename... Done, char... cur, char... chars>
+struct ParseFormatCT<FormatCT<Done...>, StringCT<cur...>, '}', chars...> : UnmatchedBraceCT<FormatCT<Done...>, '}'> {};
+
+// FormatCT of SCT("...").
+template <typename>
+struct PlaceholderFormatCT;
+template <char... chars>
+struct PlaceholderFormatCT<StringCT<chars...>> : ParseFormatCT<FormatCT<>, StringCT<>, chars...> {};
+
 template <typename T, bool...>
 struct PrintfConvert {};
 
@@ -0,0 +1,426 @@
+#ifndef _TEXT_FORMAT_HPP_
+#define _TEXT_FORMAT_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+
+// How the consumer writes times: seconds since the epoch, or YYYY-MM-DD HH:MM:SS in local time or UTC. Sub-second digits follow either way.
+enum class TimeFormat { Epoch, Local, Utc };
+
+namespace text {
+// Consumer side formatting into a plain char buffer, drained to the log file once per batch.
+// Output is byte for byte what operator<< on the file would give, including the precision and fill that FormattedValue and the
+// time types leave behind on the stream. That state is kept on the stream itself, so types without a codec can still go through it.
+
+class Writer;
+
+// maxLength: longest text of a T, 0 when there is no bound. write() assumes maxLength bytes were reserved, unbounded ones reserve themselves.
+template <typename T, typename = void>
+struct codec {
+    static constexpr std::size_t maxLength = 0;
+    static void write(Writer &w, const T &value);
+};
+
+class Writer {
+   public:
+    static constexpr std::size_t capacity = 64 * 1024;
+    static constexpr std::size_t maxSecondsLength = 32;
+
+   private:
+    std::ostream &os;
+    std::unique_ptr<char[]> buffer;
+    char *pos;
+    char *limit;    // One short of the end, snprintf needs room for its '\0'.
+    std::uint64_t total;    // Bytes that went to the stream.
+
+    // The seconds of the last time written, rendered with the '.' after them. Records mostly share a second.
+    TimeFormat timeformat;
+    bool cached;
+    long second;
+    std::size_t secondLength;
+    char rendered[maxSecondsLength];
+
+    void renderSeconds(long seconds);
+
+   public:
+    explicit Writer(std::ostream &os_, TimeFormat timeformat_ = TimeFormat::Epoch)
+        : os(os_),
+          buffer{new char[capacity + 1]},
+          pos{buffer.get()},
+          limit{buffer.get() + capacity},
+          total{0},
+          timeformat{timeformat_},
+          cached{false},
+          second{0},
+          secondLength{0},
+          rendered{} {}
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    // Whatever is buffered goes to the stream, which then is up to date.
+    void drain() {
+        if (this->pos != this->buffer.get()) {
+            this->os.write(this->buffer.get(), this->pos - this->buffer.get());
+            this->total += this->pos - this->buffer.get();
+            this->pos = this->buffer.get();
+        }
+    }
+
+    // Drained so far, and whatever account() added.
+    std::uint64_t written() const { return this->total; }
+    // Written to the stream without going through the Writer, eg. binary records.
+    void account(std::size_t n) { this->total += n; }
+
+    __attribute__((always_inline)) inline void reserve(std::size_t n) {
+        if (__builtin_expect(static_cast<std::size_t>(this->limit - this->pos) < n, 0)) {
+            this->drain();
+        }
+    }
+
+    __attribute__((always_inline)) inline std::size_t room() const { return this->limit - this->pos; }
+    __attribute__((always_inline)) inline char *cursor() { return this->pos; }
+    __attribute__((always_inline)) inline void advance(std::size_t n) { this->pos += n; }
+
+    __attribute__((always_inline)) inline void put(char c) { *this->pos++ = c; }
+
+    __attribute__((always_inline)) inline void append(const char *str, std::size_t length) {
+        std::memcpy(this->pos, str, length);
+        this->pos += length;
+    }
+
+    // Reserves for itself. Anything larger than the buffer goes straight to the stream.
+    void appendChecked(const char *str, std::size_t length) {
+        if (__builtin_expect(this->room() < length, 0)) {
+            this->drain();
+            if (length > capacity) {
+                this->os.write(str, length);
+                this->total += length;
+                return;
+            }
+        }
+        this->append(str, length);
+    }
+
+    template <bool checked = true, typename T>
+    __attribute__((always_inline)) inline void write(const T &value) {
+        if (checked && codec<T>::maxLength != 0) {
+            this->reserve(codec<T>::maxLength);
+        }
+        codec<T>::write(*this, value);
+    }
+
+    template <typename T>
+    Writer &operator<<(const T &value) {
+        this->write(value);
+        return *this;
+    }
+
+    // The stream, drained. For state (precision, fill) and whatever has no codec.
+    std::ostream &stream() { return this->os; }
+
+    // seconds and the '.', from the cache. Needs maxSecondsLength reserved, that much is copied.
+    __attribute__((always_inline)) inline void writeSeconds(long seconds) {
+        if (__builtin_expect(!this->cached || seconds != this->second, 0)) {
+            this->renderSeconds(seconds);
+        }
+        std::memcpy(this->pos, this->rendered, maxSecondsLength);
+        this->pos += this->secondLength;
+    }
+};
+
+namespace detail {
+static constexpr char digitpairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Digits of v, written backwards ending at end. Returns the first digit.
+template <typename U>
+__attribute__((always_inline)) inline char *utoa(char *end, U v) {
+    while (v >= 100) {
+        const auto idx = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        *--end = digitpairs[idx + 1];
+        *--end = digitpairs[idx];
+    }
+    if (v >= 10) {
+        const auto idx = static_cast<unsigned>(v) * 2;
+        *--end = digitpairs[idx + 1];
+        *--end = digitpairs[idx];
+    } else {
+        *--end = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
+template <typename T>
+__attribute__((always_inline)) inline char *itoa(char *end, T v, std::true_type) {
+    using U = typename std::make_unsigned<T>::type;
+    if (v < 0) {
+        auto begin = utoa(end, static_cast<U>(U(0) - static_cast<U>(v)));
+        *--begin = '-';
+        return begin;
+    }
+    return utoa(end, static_cast<U>(v));
+}
+
+template <typename T>
+__attribute__((always_inline)) inline char *itoa(char *end, T v, std::false_type) {
+    return utoa(end, v);
+}
+
+template <typename T>
+struct integerLength {
+    static constexpr std::size_t value = std::numeric_limits<T>::digits10 + 2;
+};
+
+// Right aligned in width, what setw does with the default adjustfield.
+template <typename T>
+__attribute__((always_inline)) inline void writeInteger(Writer &w, T v, char fill, int width) {
+    char tmp[integerLength<T>::value];
+    char *const end = tmp + sizeof(tmp);
+    const char *begin = itoa(end, v, std::is_signed<T>{});
+    const std::size_t length = end - begin;
+    if (width > 0 && static_cast<std::size_t>(width) > length) {
+        std::memset(w.cursor(), fill, width - length);
+        w.advance(width - length);
+    }
+    w.append(begin, length);
+}
+
+// snprintf, as ostream itself does underneath. Retried with enough room if it didn't fit. Out of line, it is slow anyway.
+template <typename T>
+__attribute__((noinline)) inline void writeFloat(Writer &w, const char *format, int precision, T v) {
+    auto length = static_cast<std::size_t>(std::snprintf(w.cursor(), w.room() + 1, format, precision, v));
+    if (__builtin_expect(length > w.room(), 0)) {
+        std::unique_ptr<char[]> tmp{new char[length + 1]};
+        std::snprintf(tmp.get(), length + 1, format, precision, v);
+        w.appendChecked(tmp.get(), length);
+        return;
+    }
+    w.advance(length);
+}
+
+// Exactly digits digits of v, zero filled, which has to be below 10^digits.
+template <int digits>
+__attribute__((always_inline)) inline void writeFraction(Writer &w, unsigned v) {
+    char *end = w.cursor() + digits;
+    for (int i = 0; i < digits / 2; i++) {
+        const auto idx = (v % 100) * 2;
+        v /= 100;
+        *--end = digitpairs[idx + 1];
+        *--end = digitpairs[idx];
+    }
+    if (digits % 2) {
+        *--end = static_cast<char>('0' + v);
+    }
+    w.advance(digits);
+}
+
+// Sub-second part of a time: digits of it, the way setw(digits) with a '0' fill puts it, also when out of range.
+template <int digits, unsigned limit>
+__attribute__((always_inline)) inline void writeSubSeconds(Writer &w, long v) {
+    if (__builtin_expect(v >= 0 && v < static_cast<long>(limit), 1)) {
+        writeFraction<digits>(w, static_cast<unsigned>(v));
+    } else {
+        writeInteger(w, v, '0', digits);
+    }
+}
+
+template <typename T>
+struct is_plain_integer {
+    using type = typename std::remove_cv<T>::type;
+    static constexpr bool value = std::is_integral<type>::value && !std::is_same<type, bool>::value && !std::is_same<type, char>::value &&
+                                  !std::is_same<type, signed char>::value && !std::is_same<type, unsigned char>::value;
+};
+}    // detail end
+
+template <typename T>
+struct codec<T, typename std::enable_if<detail::is_plain_integer<T>::value>::type> {
+    static constexpr std::size_t maxLength = detail::integerLength<T>::value;
+    static void write(Writer &w, const T &value) { detail::writeInteger(w, value, ' ', 0); }
+};
+
+template <>
+struct codec<bool> {
+    static constexpr std::size_t maxLength = 1;
+    static void write(Writer &w, const bool &value) { w.put(value ? '1' : '0'); }
+};
+
+// Characters are written as they are.
+template <typename T>
+struct codec<T, typename std::enable_if<std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value>::type> {
+    static constexpr std::size_t maxLength = 1;
+    static void write(Writer &w, const T &value) { w.put(static_cast<char>(value)); }
+};
+
+// %g at the stream's precision. The bound holds up to precision 17, past that the buffer is checked again.
+template <typename T>
+struct codec<T, typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, double>::value>::type> {
+    static constexpr std::size_t maxLength = 32;
+    static void write(Writer &w, const T &value) { detail::writeFloat(w, "%.*g", static_cast<int>(w.stream().precision()), static_cast<double>(value)); }
+};
+
+template <>
+struct codec<long double> {
+    static constexpr std::size_t maxLength = 48;
+    static void write(Writer &w, const long double &value) { detail::writeFloat(w, "%.*Lg", static_cast<int>(w.stream().precision()), value); }
+};
+
+template <typename T>
+struct codec<T *, typename std::enable_if<std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+    static constexpr std::size_t maxLength = 0;
+    static void write(Writer &w, const char *value) { w.appendChecked(value, std::strlen(value)); }
+};
+
+template <>
+struct codec<std::string> {
+    static constexpr std::size_t maxLength = 0;
+    static void write(Writer &w, const std::string &value) { w.appendChecked(value.data(), value.size()); }
+};
+
+// The bytes, then the marker if cut. Bounded unless a std::string may have been moved in. A spilled string is longer than it reserved:
+// it reserves for itself, leaving the fields after it what they had.
+template <std::size_t capacity, bool movable, std::size_t limit>
+struct codec<CapturedString<capacity, movable, limit>> {
+    using marker = typename CapturedString<capacity, movable, limit>::marker;
+    static constexpr std::size_t maxLength = movable ? 0 : capacity + sizeof(marker::str) - 1;
+    static void write(Writer &w, const CapturedString<capacity, movable, limit> &value) {
+        if (movable) {
+            w.appendChecked(value.data(), value.size());
+        } else if (__builtin_expect(value.spilled() != 0, 0)) {
+            writeSpilled(w, value);
+            return;
+        } else {
+            w.append(value.data(), value.size());
+        }
+        if (value.truncated()) {
+            w.appendChecked(marker::str, sizeof(marker::str) - 1);
+        }
+    }
+
+    __attribute__((noinline)) static void writeSpilled(Writer &w, const CapturedString<capacity, movable, limit> &value) {
+        const std::size_t rest = w.room() - maxLength;
+        value.forEach([&w](const char *bytes, std::size_t length) { w.appendChecked(bytes, length); });
+        if (value.truncated()) {
+            w.appendChecked(marker::str, sizeof(marker::str) - 1);
+        }
+        w.reserve(rest);
+    }
+};
+
+// seconds.micros, micros zero filled to 6, seconds as the Writer's TimeFormat has them. The fill stays '0' on the stream, as with operator<<.
+template <>
+struct codec<timestamp::MicroSecondTime> {
+    static constexpr std::size_t maxLength = Writer::maxSecondsLength + detail::integerLength<long>::value;
+    static void write(Writer &w, const timestamp::MicroSecondTime &value) {
+        w.writeSeconds(value.getSeconds());
+        detail::writeSubSeconds<6, 1000000>(w, value.getMicroSeconds());
+        w.stream().fill('0');
+    }
+};
+
+template <clockid_t clk_id>
+struct codec<timestamp::NanoSecondTime<clk_id>> {
+    static constexpr std::size_t maxLength = Writer::maxSecondsLength + detail::integerLength<long>::value;
+    static void write(Writer &w, const timestamp::NanoSecondTime<clk_id> &value) {
+        w.writeSeconds(value.getSeconds());
+        detail::writeSubSeconds<9, 1000000000>(w, value.getNanoSeconds());
+        w.stream().fill('0');
+    }
+};
+
+// Converted to wall clock time here, on the consumer.
+template <>
+struct codec<timestamp::TscTime> {
+    static constexpr std::size_t maxLength = codec<timestamp::NanoSecondTime<>>::maxLength;
+    static void write(Writer &w, const timestamp::TscTime &value) { codec<timestamp::NanoSecondTime<>>::write(w, value.toNanoSecondTime()); }
+};
+
+// writeFixed: %f at fixed_precision, which then stays the stream's precision.
+template <typename T, int fixed_precision>
+struct codec<FormattedValue<T, fixed_precision>> {
+    static constexpr std::size_t maxLength = 1 + std::numeric_limits<double>::max_exponent10 + 1 + 1 + fixed_precision;
+    static void write(Writer &w, const FormattedValue<T, fixed_precision> &fv) {
+        w.stream().precision(fixed_precision);
+        detail::writeFloat(w, "%.*f", fixed_precision, static_cast<double>(fv.value));
+    }
+};
+
+// writePadded: right aligned in width, filled with (char)padding, which then stays the stream's fill.
+template <typename T, int padding, int width>
+struct codec<FormattedValue<T, padding, width>> {
+    using value_type = typename FormattedValue<T, padding, width>::value_type;
+    static constexpr std::size_t maxLength =
+        static_cast<std::size_t>(width) > detail::integerLength<value_type>::value ? width : detail::integerLength<value_type>::value;
+    static void write(Writer &w, const FormattedValue<T, padding, width> &fv) {
+        detail::writeInteger(w, fv.value, (char)padding, width);
+        w.stream().fill((char)padding);
+    }
+};
+
+// Once per second. Epoch is what operator<< writes, the dates are strftime's.
+__attribute__((noinline)) inline void Writer::renderSeconds(long seconds) {
+    std::size_t length = 0;
+    if (this->timeformat == TimeFormat::Epoch) {
+        char tmp[detail::integerLength<long>::value];
+        char *const end = tmp + sizeof(tmp);
+        const char *begin = detail::itoa(end, seconds, std::true_type{});
+        length = end - begin;
+        std::memcpy(this->rendered, begin, length);
+    } else {
+        const std::time_t t = seconds;
+        struct tm tm;
+        const bool ok = this->timeformat == TimeFormat::Local ? localtime_r(&t, &tm) != nullptr : gmtime_r(&t, &tm) != nullptr;
+        length = ok ? std::strftime(this->rendered, maxSecondsLength - 1, "%Y-%m-%d %H:%M:%S", &tm) : 0;
+    }
+    this->rendered[length] = '.';
+    this->secondLength = length + 1;
+    this->second = seconds;
+    this->cached = true;
+}
+
+// No codec, operator<< on the stream itself.
+template <typename T, typename U>
+void codec<T, U>::write(Writer &w, const T &value) {
+    w.drain();
+    w.stream() << value;
+}
+
+// Sum of maxLength, 0 if any of them is unbounded.
+template <typename... Args>
+struct maxLengthOf;
+template <>
+struct maxLengthOf<> {
+    static constexpr std::size_t value = 0;
+    static constexpr bool bounded = true;
+};
+template <typename T, typename... Args>
+struct maxLengthOf<T, Args...> {
+    static constexpr bool bounded = codec<T>::maxLength != 0 && maxLengthOf<Args...>::bounded;
+    static constexpr std::size_t value = bounded ? codec<T>::maxLength + maxLengthOf<Args...>::value : 0;
+};
+
+}    // text end
+}    // logger end
+}    // common end
+#endif
@@ -0,0 +1,144 @@
+#ifndef _THREAD_OPTIONS_HPP_
+#define _THREAD_OPTIONS_HPP_
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace common {
+namespace logger {
+
+// Where and how a consumer thread runs, eg. ThreadOptions{}.affinity({3}).idle(), see AsyncLogger::start.
+// Applied by the thread to itself before its loop, in this order: affinity, scheduling, then the callback. Errors are thrown from start().
+// Unset, the thread inherits all of it from the one that starts it, as any std::thread, ie. possibly the isolated cores of the producers.
+class ThreadOptions {
+   public:
+    enum class Scheduling { Inherit, Other, Fifo, Idle };
+
+   private:
+    std::vector<int> cpus;
+    Scheduling scheduling;
+    int priority;    // SCHED_FIFO, 1 to 99.
+    int niceness;    // SCHED_OTHER.
+    std::function<void()> callback;
+
+    static void check(int error, const char *what) {
+        if (error != 0) {
+            throw std::system_error{error, std::generic_category(), what};
+        }
+    }
+
+    static void schedule(int policy, int priority) {
+        sched_param param{};
+        param.sched_priority = priority;
+        check(pthread_setschedparam(pthread_self(), policy, &param), "Logger thread scheduling");
+    }
+
+   public:
+    ThreadOptions() : cpus{}, scheduling{Scheduling::Inherit}, priority{0}, niceness{0}, callback{} {}
+    ThreadOptions(const ThreadOptions &) = default;
+    ThreadOptions(ThreadOptions &&) = default;
+    ThreadOptions &operator=(const ThreadOptions &) = default;
+    ThreadOptions &operator=(ThreadOptions &&) = default;
+    // Out of line, the vector's and the function's would otherwise be inlined into every start().
+    __attribute__((noinline)) ~ThreadOptions() {}
+
+    // The cpus it may run on, eg. a housekeeping core away from the isolated ones.
+    ThreadOptions &affinity(std::vector<int> cpus_) {
+        this->cpus = std::move(cpus_);
+        return *this;
+    }
+    // Real time, before anything SCHED_OTHER. Needs CAP_SYS_NICE or an RLIMIT_RTPRIO.
+    ThreadOptions &fifo(int priority_) {
+        this->scheduling = Scheduling::Fifo;
+        this->priority = priority_;
+        return *this;
+    }
+    // Only when the cpu has nothing else to do. A consumer that falls behind under load, size the queues for it.
+    ThreadOptions &idle() {
+        this->scheduling = Scheduling::Idle;
+        return *this;
+    }
+    // SCHED_OTHER with a nice value of its own. Lowering it below the process's needs CAP_SYS_NICE.
+    ThreadOptions &nice(int niceness_) {
+        this->scheduling = Scheduling::Other;
+        this->niceness = niceness_;
+        return *this;
+    }
+    // Last thing on the thread before its loop, eg. mlockall, a NUMA policy, a perf counter. May throw.
+    ThreadOptions &onStart(std::function<void()> callback_) {
+        this->callback = std::move(callback_);
+        return *this;
+    }
+
+    // On the thread to be set up.
+    void apply() const {
+        if (!this->cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const int cpu : this->cpus) {
+                if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                    throw std::system_error{EINVAL, std::generic_category(), "Logger thread affinity"};
+                }
+                CPU_SET(cpu, &set);
+            }
+            check(pthread_setaffinity_np(pthread_self(), sizeof(set), &set), "Logger thread affinity");
+        }
+        switch (this->scheduling) {
+            case Scheduling::Inherit: break;
+            case Scheduling::Fifo: schedule(SCHED_FIFO, this->priority); break;
+            case Scheduling::Idle: schedule(SCHED_IDLE, 0); break;
+            case Scheduling::Other:
+                schedule(SCHED_OTHER, 0);
+                // Per thread on Linux, by its tid.
+                check(setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), this->niceness) != 0 ? errno : 0, "Logger thread nice");
+                break;
+        }
+        if (this->callback) {
+            this->callback();
+        }
+    }
+};
+
+// A thread named name and set up as options say, that then runs f. Returns once it does, throws what setting it up did, the thread is gone then.
+template <typename F>
+std::thread startThread(std::string &&name, ThreadOptions &&options, F &&f) {
+    std::promise<void> started;
+    auto ready = started.get_future();
+    std::thread thread{[](std::string &&threadname, ThreadOptions &&setup, std::promise<void> &&promise, typename std::decay<F>::type &&body) {
+                           try {
+                               if (const auto errornum = pthread_setname_np(pthread_self(), threadname.c_str())) {
+                                   throw std::runtime_error("LoggerName Error: " + std::to_string(errornum));
+                               }
+                               setup.apply();
+                           } catch (...) {
+                               promise.set_exception(std::current_exception());
+                               return;
+                           }
+                           promise.set_value();
+                           body();
+                       },
+                       std::move(name), std::move(options), std::move(started), std::forward<F>(f)};
+    try {
+        ready.get();
+    } catch (...) {
+        thread.join();
+        throw;
+    }
+    return thread;
+}
+}    // logger end
+}    // common end
+#endif
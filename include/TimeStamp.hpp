@@ -231,7 +231,7 @@ class NanoSecondTime : public Time {
 
     const NanoSecondTime &operator=(const IntegralType &val) {
         this->t.tv_sec = val / UnitsPerSec;
-        this->t.tv_usec = val % UnitsPerSec;
+        this->t.tv_nsec = val % UnitsPerSec;
         return *this;
     }
 
@@ -261,6 +261,13 @@ class NanoSecondTime : public Time {
         return s;
     }
 };
+
+// Any time as the MicroSecondTime the consumers keep as their last time.
+inline MicroSecondTime toMicroSecondTime(const MicroSecondTime &t) { return t; }
+template <typename T>
+MicroSecondTime toMicroSecondTime(const T &t) {
+    return MicroSecondTime{static_cast<integral::microsecond>(t.getSeconds()) * 1000000 + t.getMicroSeconds()};
+}
 }
 }
 #endif
@@ -0,0 +1,184 @@
+#ifndef _TSC_TIMESTAMP_HPP_
+#define _TSC_TIMESTAMP_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+#include "TimeStamp.hpp"
+
+namespace common {
+namespace timestamp {
+
+// Raw ticks: rdtsc where there is one, CLOCK_MONOTONIC_RAW nanoseconds otherwise.
+// Only comparable across cores with an invariant TSC (constant_tsc and nonstop_tsc in /proc/cpuinfo).
+__attribute__((always_inline)) inline std::uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    std::uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return static_cast<std::uint64_t>(hi) << 32 | lo;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// Maps ticks to CLOCK_REALTIME nanoseconds, ns = base + (ticks - tsc) * rate. One per process, see instance().
+// Recalibrated by whichever thread converts, once ticks are an interval past the last time. The rate is measured against the clock over
+// that interval, then set so the mapping meets the clock an interval later: no steps, converted times stay monotonic and follow NTP slewing.
+// Only an error over maxSlew (eg. settimeofday) is stepped.
+// Conversion is lock free, a seqlock over the mapping. Recalibration takes a few clock_gettime calls, in one thread at a time.
+class TscClock {
+   public:
+    static constexpr std::int64_t interval = 100000000;    // ns
+    static constexpr std::int64_t maxSlew = 1000000;       // ns
+
+   private:
+    struct Sample {
+        std::uint64_t tsc;
+        std::int64_t ns;
+    };
+
+    std::atomic<unsigned> seq;
+    std::atomic<std::uint64_t> tsc;
+    std::atomic<std::int64_t> base;
+    std::atomic<double> rate;    // ns per tick.
+    std::atomic<std::uint64_t> next;
+    std::atomic<bool> calibrating;
+    Sample last;    // Clock at the last recalibration. Only touched by the recalibrating thread.
+
+    // Tightest of a few clock_gettime calls between two rdtsc.
+    static Sample sample() {
+        Sample best{0, 0};
+        std::uint64_t width = ~std::uint64_t{0};
+        for (int i = 0; i < 5; i++) {
+            timespec ts;
+            const auto before = rdtsc();
+            clock_gettime(CLOCK_REALTIME, &ts);
+            const auto after = rdtsc();
+            if (after - before < width) {
+                width = after - before;
+                best = Sample{before + width / 2, static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec};
+            }
+        }
+        return best;
+    }
+
+    void publish(std::uint64_t tsc_, std::int64_t base_, double rate_) {
+        const auto s = this->seq.load(std::memory_order_relaxed);
+        this->seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->tsc.store(tsc_, std::memory_order_relaxed);
+        this->base.store(base_, std::memory_order_relaxed);
+        this->rate.store(rate_, std::memory_order_relaxed);
+        this->seq.store(s + 2, std::memory_order_release);
+        this->next.store(tsc_ + static_cast<std::uint64_t>(interval / rate_), std::memory_order_relaxed);
+    }
+
+    std::int64_t map(std::uint64_t ticks) const {
+        unsigned s;
+        std::uint64_t tsc_;
+        std::int64_t base_;
+        double rate_;
+        do {
+            s = this->seq.load(std::memory_order_acquire);
+            tsc_ = this->tsc.load(std::memory_order_relaxed);
+            base_ = this->base.load(std::memory_order_relaxed);
+            rate_ = this->rate.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((s & 1) || s != this->seq.load(std::memory_order_relaxed));
+        // Signed, ticks may be from before the last recalibration.
+        return base_ + static_cast<std::int64_t>(static_cast<double>(static_cast<std::int64_t>(ticks - tsc_)) * rate_);
+    }
+
+    void recalibrate() {
+        const Sample now = sample();
+        if (now.tsc <= this->last.tsc || now.ns <= this->last.ns) {
+            this->last = now;
+            this->publish(now.tsc, now.ns, this->rate.load(std::memory_order_relaxed));
+            return;
+        }
+        const double measured = static_cast<double>(now.ns - this->last.ns) / static_cast<double>(now.tsc - this->last.tsc);
+        this->last = now;
+        const std::int64_t mapped = this->map(now.tsc);
+        const std::int64_t error = now.ns - mapped;
+        if (error > maxSlew || error < -maxSlew) {
+            this->publish(now.tsc, now.ns, measured);
+        } else {
+            this->publish(now.tsc, mapped, measured * static_cast<double>(interval + error) / interval);
+        }
+    }
+
+    // The first rate is measured over 10ms, the first recalibration already improves on it.
+    TscClock() : seq{0}, tsc{0}, base{0}, rate{1.0}, next{0}, calibrating{false}, last(sample()) {
+        Sample now;
+        do {
+            now = sample();
+        } while (now.ns - this->last.ns < interval / 10 && now.ns >= this->last.ns);
+        const double measured = now.tsc > this->last.tsc && now.ns > this->last.ns
+                                    ? static_cast<double>(now.ns - this->last.ns) / static_cast<double>(now.tsc - this->last.tsc)
+                                    : 1.0;
+        this->last = now;
+        this->publish(now.tsc, now.ns, measured);
+    }
+
+   public:
+    TscClock(const TscClock &) = delete;
+    TscClock &operator=(const TscClock &) = delete;
+
+    // Calibrated on first use, which takes 10ms. Call it early to keep that off the first conversion.
+    static TscClock &instance() {
+        static TscClock clock;
+        return clock;
+    }
+
+    // Nanoseconds since the epoch.
+    std::int64_t toNanoSeconds(std::uint64_t ticks) {
+        if (ticks >= this->next.load(std::memory_order_relaxed) && !this->calibrating.exchange(true, std::memory_order_acquire)) {
+            this->recalibrate();
+            this->calibrating.store(false, std::memory_order_release);
+        }
+        return this->map(ticks);
+    }
+};
+
+// Just the ticks, 8 bytes in the record and no clock call for the producer. Wall clock time only when asked for, ie. by the consumer
+// writing it, see TscClock. Written like NanoSecondTime<>.
+class TscTime : public Time {
+   protected:
+    using UnderlyingType = std::uint64_t;
+    UnderlyingType t;
+
+   public:
+    using IntegralType = integral::nanosecond;
+
+    static const auto UnitsPerSec = 1000000000;
+
+    TscTime() : t{rdtsc()} {}
+    explicit TscTime(UnderlyingType ticks) : t{ticks} {}
+
+    void set() { this->t = rdtsc(); }
+
+    const UnderlyingType &getUnderlying() const { return this->t; }
+
+    // These convert, every call.
+    IntegralType getIntegral() const { return TscClock::instance().toNanoSeconds(this->t); }
+    NanoSecondTime<> toNanoSecondTime() const { return NanoSecondTime<>{this->getIntegral()}; }
+    SecondType getSeconds() const { return this->getIntegral() / UnitsPerSec; }
+    MilliSecondType getMilliSeconds() const { return this->getMicroSeconds() / 1000; }
+    MicroSecondType getMicroSeconds() const { return this->getNanoSeconds() / 1000; }
+    NanoSecondType getNanoSeconds() const { return this->getIntegral() % UnitsPerSec; }
+
+    // Ticks order the same as the times they map to.
+    bool operator<(const TscTime &rhs) const { return this->t < rhs.t; }
+    bool operator>(const TscTime &rhs) const { return rhs < *this; }
+
+    friend std::ostream &operator<<(std::ostream &s, const TscTime &t) { return s << t.toNanoSecondTime(); }
+};
+
+inline MicroSecondTime toMicroSecondTime(const TscTime &t) { return MicroSecondTime{t.getIntegral() / 1000}; }
+}
+}
+#endif
@@ -0,0 +1,442 @@
+#ifndef _URING_LOGGER_HPP_
+#define _URING_LOGGER_HPP_
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "Logger.hpp"
+
+namespace common {
+namespace logger {
+namespace uring {
+
+// Just enough of io_uring for writes, on the raw syscalls. Consumer thread only.
+class Ring {
+   private:
+    int fd;
+    unsigned entries;
+    void *sqRing;
+    std::size_t sqRingSize;
+    void *cqRing;
+    std::size_t cqRingSize;
+    io_uring_sqe *sqes;
+    unsigned *sqTail;
+    unsigned sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    io_uring_cqe *cqes;
+    unsigned queued;    // Prepared, not yet submitted.
+
+    static void check(bool ok, const char *what) {
+        if (!ok) {
+            throw std::system_error{errno, std::generic_category(), what};
+        }
+    }
+
+    template <typename T>
+    static T *at(void *base, unsigned offset) {
+        return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+    }
+
+    // IORING_OP_WRITE needs 5.6, older kernels fail the probe altogether.
+    bool supportsWrite() const {
+        constexpr unsigned ops = 256;
+        std::unique_ptr<char[]> mem{new char[sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)]()};
+        auto probe = reinterpret_cast<io_uring_probe *>(mem.get());
+        if (syscall(__NR_io_uring_register, this->fd, IORING_REGISTER_PROBE, probe, ops) < 0) {
+            return false;
+        }
+        return probe->last_op >= IORING_OP_WRITE && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    void unmap() {
+        if (this->sqes) {
+            munmap(this->sqes, this->entries * sizeof(io_uring_sqe));
+        }
+        if (this->cqRing && this->cqRing != this->sqRing) {
+            munmap(this->cqRing, this->cqRingSize);
+        }
+        if (this->sqRing) {
+            munmap(this->sqRing, this->sqRingSize);
+        }
+        close(this->fd);
+    }
+
+   public:
+    // Throws std::system_error where io_uring is missing, disabled or not allowed.
+    explicit Ring(unsigned entries_) : fd{-1}, sqRing{nullptr}, cqRing{nullptr}, sqes{nullptr}, queued{0} {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        this->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries_, &params));
+        check(this->fd >= 0, "io_uring_setup");
+        this->entries = params.sq_entries;
+        this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            this->sqRingSize = this->cqRingSize = std::max(this->sqRingSize, this->cqRingSize);
+        }
+
+        void *mem = mmap(nullptr, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+        if (mem == MAP_FAILED) {
+            const int err = errno;
+            this->unmap();
+            throw std::system_error{err, std::generic_category(), "io_uring sq mmap"};
+        }
+        this->sqRing = mem;
+        mem = single ? this->sqRing : mmap(nullptr, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+        if (mem == MAP_FAILED) {
+            const int err = errno;
+            this->unmap();
+            throw std::system_error{err, std::generic_category(), "io_uring cq mmap"};
+        }
+        this->cqRing = mem;
+        mem = mmap(nullptr, this->entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES);
+        if (mem == MAP_FAILED) {
+            const int err = errno;
+            this->unmap();
+            throw std::system_error{err, std::generic_category(), "io_uring sqes mmap"};
+        }
+        this->sqes = static_cast<io_uring_sqe *>(mem);
+
+        this->sqTail = at<unsigned>(this->sqRing, params.sq_off.tail);
+        this->sqMask = *at<unsigned>(this->sqRing, params.sq_off.ring_mask);
+        this->sqArray = at<unsigned>(this->sqRing, params.sq_off.array);
+        this->cqHead = at<unsigned>(this->cqRing, params.cq_off.head);
+        this->cqTail = at<unsigned>(this->cqRing, params.cq_off.tail);
+        this->cqMask = *at<unsigned>(this->cqRing, params.cq_off.ring_mask);
+        this->cqes = at<io_uring_cqe>(this->cqRing, params.cq_off.cqes);
+
+        if (!this->supportsWrite()) {
+            this->unmap();
+            throw std::system_error{EOPNOTSUPP, std::generic_category(), "io_uring write"};
+        }
+    }
+    ~Ring() { this->unmap(); }
+    Ring(Ring &&) = delete;
+
+    unsigned size() const { return this->entries; }
+    bool hasQueued() const { return this->queued != 0; }
+
+    // Prepared only, see enter(). The caller keeps no more than size() in flight. offset -1 is the file position.
+    void write(int filefd, const char *data, unsigned length, std::uint64_t offset, std::uint64_t user, std::uint8_t flags) {
+        const unsigned tail = *this->sqTail;
+        const unsigned idx = tail & this->sqMask;
+        io_uring_sqe *sqe = &this->sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->flags = flags;
+        sqe->fd = filefd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(data);
+        sqe->len = length;
+        sqe->off = offset;
+        sqe->user_data = user;
+        this->sqArray[idx] = idx;
+        __atomic_store_n(this->sqTail, tail + 1, __ATOMIC_RELEASE);
+        this->queued++;
+    }
+
+    // Submits whatever is prepared, then waits for at least wait completions.
+    void enter(unsigned wait) {
+        while (true) {
+            const auto ret = syscall(__NR_io_uring_enter, this->fd, this->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret >= 0) {
+                this->queued -= static_cast<unsigned>(ret);
+                return;
+            }
+            check(errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter");
+        }
+    }
+
+    // f(user, res) for every completion there is, without waiting. Each is consumed before f(), which may throw.
+    template <typename F>
+    void reap(F &&f) {
+        unsigned head = *this->cqHead;
+        while (head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe cqe = this->cqes[head & this->cqMask];
+            __atomic_store_n(this->cqHead, ++head, __ATOMIC_RELEASE);
+            f(cqe.user_data, cqe.res);
+        }
+    }
+};
+}    // uring end
+
+// Output buffer of LogFile::Uring. A few buffers taking turns: a filled one is submitted as an async write and the consumer goes on
+// formatting into the next, only waiting when that one is still not written. Regular files get explicit offsets so that the writes may
+// complete in any order. Anything else (pipes) has one write in flight at a time, the filled buffers behind it follow in order.
+// Without io_uring the same buffers go out with plain write(2) as they fill.
+class UringBuffer : public LogBuffer {
+   public:
+    struct Stats {
+        std::uint64_t writes;    // Submitted, or write(2) calls without io_uring.
+        std::uint64_t bytes;
+        std::uint64_t waits;    // Times the consumer found the next buffer still not written.
+    };
+
+   private:
+    static constexpr std::size_t pagesize = 4096;
+
+    struct Slot {
+        char *data;
+        std::size_t length;
+        std::size_t done;
+        std::uint64_t offset;
+        bool busy;
+    };
+
+    const int fd;
+    const std::size_t size;
+    const std::chrono::microseconds maxDelay;
+    std::chrono::steady_clock::time_point lastWrite;
+    std::unique_ptr<uring::Ring> ring;    // Null without io_uring.
+    char *memory;
+    std::vector<Slot> slots;
+    std::size_t current;
+    unsigned filled;    // Busy slots, submitted or queued behind the one in flight.
+    bool seekable;
+    std::uint64_t offset;
+    std::atomic<std::uint64_t> writes;
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::uint64_t> waits;
+
+    static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    void queue(std::size_t idx) {
+        Slot &slot = this->slots[idx];
+        const auto left = slot.length - slot.done;
+        this->ring->write(this->fd, slot.data + slot.done, static_cast<unsigned>(left), this->seekable ? slot.offset + slot.done : std::uint64_t(-1), idx, 0);
+        bump(this->writes, 1);
+    }
+
+    void complete(std::uint64_t idx, int res) {
+        Slot &slot = this->slots[idx];
+        if (res == -EAGAIN || res == -EINTR) {
+            this->queue(idx);
+            return;
+        }
+        if (res >= 0) {
+            bump(this->bytes, res);
+            slot.done += res;
+            if (slot.done < slot.length) {
+                this->queue(idx);    // Short write, the rest of it.
+                return;
+            }
+        }
+        slot.busy = false;
+        this->filled--;
+        if (!this->seekable && this->filled > 0) {
+            this->queue((idx + 1) % this->slots.size());
+        }
+        if (res < 0) {
+            throw std::system_error{-res, std::generic_category(), "Logfile write"};
+        }
+    }
+
+    // Completions so far, with wait until slot idx is free too. Whatever that queued is submitted.
+    void reap(std::size_t idx, bool wait) {
+        while (true) {
+            this->ring->reap([this](std::uint64_t user, int res) { this->complete(user, res); });
+            if (!wait || !this->slots[idx].busy) {
+                break;
+            }
+            this->ring->enter(1);
+        }
+        if (this->ring->hasQueued()) {
+            this->ring->enter(0);
+        }
+    }
+
+    // Hands the current buffer over and moves to the next one.
+    void submit() {
+        Slot &slot = this->slots[this->current];
+        slot.length = this->pptr() - this->pbase();
+        this->lastWrite = std::chrono::steady_clock::now();
+        if (slot.length == 0) {
+            return;
+        }
+        if (!this->ring) {
+            bump(this->writes, writeAll(this->fd, slot.data, slot.length));
+            bump(this->bytes, slot.length);
+            this->setp(slot.data, slot.data + this->size);
+            return;
+        }
+        slot.done = 0;
+        slot.offset = this->offset;
+        slot.busy = true;
+        this->offset += slot.length;
+        if (this->seekable || this->filled++ == 0) {
+            this->queue(this->current);
+            this->ring->enter(0);
+        }
+        if (this->seekable) {
+            this->filled++;
+        }
+
+        this->current = (this->current + 1) % this->slots.size();
+        if (this->slots[this->current].busy) {
+            bump(this->waits, 1);
+        }
+        this->reap(this->current, true);
+        Slot &next = this->slots[this->current];
+        this->setp(next.data, next.data + this->size);
+    }
+
+   protected:
+    // Submits, doesn't wait, for a flush too. finish() does.
+    void writeOut() override { this->submit(); }
+
+   public:
+    // size per buffer, rounded up to whole pages.
+    UringBuffer(int fd_, std::size_t size_, unsigned count, unsigned maxDelay_)
+        : fd{fd_},
+          size{(size_ + pagesize - 1) & ~(pagesize - 1)},
+          maxDelay{maxDelay_},
+          lastWrite{std::chrono::steady_clock::now()},
+          memory{nullptr},
+          current{0},
+          filled{0},
+          seekable{false},
+          offset{0},
+          writes{0},
+          bytes{0},
+          waits{0} {
+        if (this->size == 0 || count == 0) {
+            throw std::invalid_argument{"Uring buffers should not be empty"};
+        }
+        void *mem = nullptr;
+        if (posix_memalign(&mem, pagesize, this->size * count) != 0) {
+            throw std::bad_alloc{};
+        }
+        this->memory = static_cast<char *>(mem);
+        for (unsigned i = 0; i < count; i++) {
+            this->slots.push_back(Slot{this->memory + i * this->size, 0, 0, 0, false});
+        }
+        this->setp(this->memory, this->memory + this->size);
+
+        if (fd_ >= 0) {
+            const auto end = lseek(fd_, 0, SEEK_END);
+            this->seekable = end >= 0;
+            this->offset = this->seekable ? end : 0;
+            try {
+                this->ring.reset(new uring::Ring{count});
+            } catch (const std::system_error &) {
+                // Plain write(2) then.
+            }
+        }
+    }
+    ~UringBuffer() {
+        try {
+            this->finish();
+        } catch (...) {
+            // Nothing to be done with it here.
+        }
+        std::free(this->memory);
+    }
+    UringBuffer(UringBuffer &&) = delete;
+
+    // Everything submitted and completed.
+    void finish() {
+        this->submit();
+        while (this->filled > 0) {
+            this->ring->enter(1);
+            this->reap(this->current, false);
+        }
+    }
+
+    // After maxDelay, but only if the next buffer is free by then. Otherwise this one keeps filling up while the others are written.
+    bool due() {
+        if (this->pptr() == this->pbase() || std::chrono::steady_clock::now() - this->lastWrite < this->maxDelay) {
+            return false;
+        }
+        const std::size_t next = (this->current + 1) % this->slots.size();
+        if (this->ring) {
+            this->reap(next, false);
+        }
+        return !this->slots[next].busy;
+    }
+    bool async() const { return static_cast<bool>(this->ring); }
+    Stats getStats() const {
+        return Stats{this->writes.load(std::memory_order_relaxed), this->bytes.load(std::memory_order_relaxed), this->waits.load(std::memory_order_relaxed)};
+    }
+};
+
+// Async writes through io_uring, falling back to write(2) where it isn't available, see UringBuffer.
+// A stalled write doesn't stall the consumer until every buffer is in flight.
+// The file is written at explicit offsets from its size at open, so it shouldn't be appended to by anyone else meanwhile.
+template <>
+class Logger<LogFile::Uring> : public AbstractLogger {
+   public:
+    static constexpr std::size_t defaultBufferSize = 1024 * 1024;
+    static constexpr unsigned defaultBuffers = 4;
+    static constexpr unsigned int defaultMaxDelay = 1000;
+
+   private:
+    UniqueFd fd;
+    UringBuffer buffer;
+
+   protected:
+    std::ostream file;
+    // maxDelay in microseconds, after which a partly filled buffer is submitted anyway.
+    Logger(std::string &&filename, std::size_t bufferSize = defaultBufferSize, unsigned buffers = defaultBuffers, unsigned int maxDelay = defaultMaxDelay)
+        : fd{::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644)}, buffer{this->fd.get(), bufferSize, buffers, maxDelay}, file{&this->buffer} {
+        this->check();
+    }
+    ~Logger() { this->close(); }
+    void check() {
+        if (this->fd.get() < 0) {
+            throw std::ios_base::failure{"Logfile not good"};
+        }
+    }
+
+   public:
+    Logger(Logger &&) = delete;
+    void flush() { this->file.flush(); }
+    // flush() only submits.
+    void settle() {
+        try {
+            this->buffer.finish();
+        } catch (const std::system_error &) {
+            this->file.setstate(std::ios::badbit);
+        }
+    }
+    bool due() { return this->buffer.due(); }
+    void close() {
+        if (this->fd.get() >= 0) {
+            try {
+                this->buffer.finish();
+            } catch (const std::system_error &) {
+                this->file.setstate(std::ios::badbit);
+            }
+            this->fd.close();
+        }
+    }
+    std::ostream &getFile() { return this->file; }
+    // Whether io_uring is in use at all.
+    bool async() const { return this->buffer.async(); }
+    UringBuffer::Stats getStats() const { return this->buffer.getStats(); }
+};
+}    // logger end
+}    // common end
+#endif
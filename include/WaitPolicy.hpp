@@ -0,0 +1,99 @@
+#ifndef _WAIT_POLICY_HPP_
+#define _WAIT_POLICY_HPP_
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <ctime>
+
+namespace common {
+namespace logger {
+namespace waitpolicy {
+// How the consumer thread waits between drains, and what producers do to wake it.
+// wait(wrote) is called by the consumer after every drain, notify() by producers after every publish, wake() on stop.
+struct WaitPolicy {};
+
+// What AsyncLogger::run always did. Sleeps microsleep after every drain, 0 never sleeps (and takes up a full core).
+class Sleep : public WaitPolicy {
+   private:
+    unsigned int microsleep;
+
+   public:
+    explicit Sleep(unsigned int microsleep_) : microsleep{microsleep_} {}
+
+    void wait(bool wrote) {
+        if (this->microsleep > 0) {
+            usleep(this->microsleep);
+        }
+    }
+
+    __attribute__((always_inline)) inline void notify() {}
+    void wake() {}
+};
+
+// Idle rounds first spin with PAUSE, then sched_yield, then park on a futex.
+// Producers only make the syscall when they see the consumer parked, otherwise notify() is a load of a mostly read cacheline.
+// There is no fence on the producer side, so a publish racing with the consumer going to park can be missed.
+// That is what the park timeout (microsleep, 1ms if 0) is for, it bounds the latency of such a missed wake up.
+template <unsigned int spins = 2000, unsigned int yields = 200>
+class Backoff : public WaitPolicy {
+   private:
+    std::atomic<int> parked __attribute__((aligned(64)));
+    std::atomic<int> doorbell;    // futex word.
+
+    // Consumer only.
+    unsigned int idle __attribute__((aligned(64)));
+    int seen;
+    timespec parktimeout;
+
+    static __attribute__((always_inline)) inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+   public:
+    explicit Backoff(unsigned int microsleep) : parked{0}, doorbell{0}, idle{0}, seen{0} {
+        const auto timeout = microsleep > 0 ? microsleep : 1000u;
+        this->parktimeout.tv_sec = timeout / 1000000;
+        this->parktimeout.tv_nsec = (timeout % 1000000) * 1000;
+    }
+
+    void wait(bool wrote) {
+        if (wrote) {
+            this->idle = 0;
+        } else if (this->idle < spins) {
+            this->idle++;
+            pause();
+        } else if (this->idle < spins + yields) {
+            this->idle++;
+            sched_yield();
+        } else if (!this->parked.load(std::memory_order_relaxed)) {
+            // Announce first and go for one more drain, only then sleep.
+            this->seen = this->doorbell.load(std::memory_order_relaxed);
+            this->parked.store(1, std::memory_order_seq_cst);
+        } else {
+            syscall(SYS_futex, reinterpret_cast<int *>(&this->doorbell), FUTEX_WAIT_PRIVATE, this->seen, &this->parktimeout, nullptr, 0);
+            this->parked.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    __attribute__((always_inline)) inline void notify() {
+        if (__builtin_expect(this->parked.load(std::memory_order_relaxed), 0)) {
+            this->wake();
+        }
+    }
+
+    void wake() {
+        this->parked.store(0, std::memory_order_relaxed);
+        this->doorbell.fetch_add(1, std::memory_order_release);
+        syscall(SYS_futex, reinterpret_cast<int *>(&this->doorbell), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+};
+
+}    // waitpolicy end
+}    // logger end
+}    // common end
+#endif
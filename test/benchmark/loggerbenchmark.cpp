@@ -1,7 +1,30 @@
 #include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MpscAsyncLogger.hpp"
 #include "MultiQueueAsyncLogger.hpp"
+#include "PerThreadAsyncLogger.hpp"
+#include "DirectLogger.hpp"
+#include "LzLogger.hpp"
+#include "MmapLogger.hpp"
+#include "RotatingLogger.hpp"
 #include "SpscAsyncLogger.hpp"
+#include "UringLogger.hpp"
 
 static constexpr auto maxmsgs = 64 * 8;
 static constexpr auto msgsize = 64;
@@ -28,6 +51,133 @@ void spscbench(benchmark::State& state) {
     }
 }
 
+// spscbench with the time taken as Time: gettimeofday for MicroSecondTime, just the ticks for TscTime, converted by the consumer.
+template <typename Time>
+void timebench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Overwrite>> logger{"alog", "a.log",
+                                                                                                                                     0u};
+    common::timestamp::TscClock::instance();
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        a += 1;
+        b += 10;
+        d += 0.33;
+        c += 7.01;
+        for (int i = 0; i < repeat; i++) {
+            logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(Time{}, 1, a, b, c, d);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// Same records as spscbench, published state.range(0) at a time through a Batch.
+void spscbatchbench(benchmark::State& state) {
+    using logger_t = common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Overwrite>>;
+    logger_t logger{"alog", "a.log", 0u};
+    const int batchsize = state.range(0);
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        a += 1;
+        b += 10;
+        d += 0.33;
+        c += 7.01;
+        for (int i = 0; i < repeat; i += batchsize) {
+            logger_t::Batch batch{logger};
+            for (int j = 0; j < batchsize; j++) {
+                batch.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, 1, a, b, c,
+                                                                                                     d);
+            }
+        }
+    }
+}
+
+// Producer side of string arguments, state.range(0) long: a std::string, then a char* into a buffer that is reused right after.
+// Both are copied into the record, what doesn't fit in the message spilled into the slots after it, see CapturedString.
+void stringbench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Overwrite>> logger{"alog", "a.log",
+                                                                                                                                     0u};
+    const std::string str(state.range(0), 's');
+    char buf[256];
+    while (state.KeepRunning()) {
+        for (int i = 0; i < repeat; i++) {
+            std::snprintf(buf, sizeof(buf), "%.*s", static_cast<int>(str.size()), str.c_str());
+            logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, str,
+                                                                                                  static_cast<const char*>(buf));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// spscbench's record, delimited or through a format. The producer copies the same arguments either way, the literals only cost the consumer.
+template <bool formatted>
+void formatbench(benchmark::State& state) {
+    using labels = common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>;
+    common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Overwrite>> logger{"alog", "a.log",
+                                                                                                                                     0u};
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        a += 1;
+        b += 10;
+        d += 0.33;
+        c += 7.01;
+        for (int i = 0; i < repeat; i++) {
+            if (formatted) {
+                logger.log<labels, SCT("order {} fill {} qty={} @ {} avg {}")>(common::timestamp::MicroSecondTime{}, 1, a, b, c, d);
+            } else {
+                logger.log<labels>(common::timestamp::MicroSecondTime{}, 1, a, b, c, d);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// state.range(0) producer threads sharing one queue, repeat messages in total per iteration.
+void mpscbench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::MpscAsyncLogger<msgsize, maxmsgs>> logger{"mlog", "m.log", 0u};
+    const int producers = state.range(0);
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&logger, p, producers]() {
+                int a = 2 + p, b = 5;
+                double c = 5.0, d = 1.22;
+                for (int i = 0; i < repeat / producers; i++) {
+                    logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, p, a,
+                                                                                                          b, c, d);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+}
+
+// Same as mpscbench, but every producer thread gets a queue of its own. Threads are new every iteration, so attaching and retiring is in there too.
+void perthreadbench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::PerThreadAsyncLogger<msgsize, maxmsgs>> logger{"plog", "p.log", 0u};
+    const int producers = state.range(0);
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&logger, p, producers]() {
+                int a = 2 + p, b = 5;
+                double c = 5.0, d = 1.22;
+                for (int i = 0; i < repeat / producers; i++) {
+                    logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, p, a,
+                                                                                                          b, c, d);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+}
+
 void mqscbench(benchmark::State& state) {
     common::logger::LoggerManager<common::logger::MultiQueueAsyncLogger<1, msgsize, maxmsgs, common::logger::safetypolicy::Overwrite>> logger{
         "blog", "b.log", 0u};
@@ -49,6 +199,743 @@ void mqscbench(benchmark::State& state) {
     }
 }
 
+// Heartbeats interleaved with wide snapshots. Fixed slots split the wide one into chunks, variable records take their exact size.
+template <typename L>
+void mixedsizebench(benchmark::State& state, L& logger) {
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        a += 1;
+        b += 10;
+        d += 0.33;
+        c += 7.01;
+        for (int i = 0; i < repeat; i++) {
+            if (i & 3) {
+                logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("HB")>>(common::timestamp::MicroSecondTime{}, a);
+            } else {
+                logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("SNAP")>>(
+                    common::timestamp::MicroSecondTime{}, a, b, c, d, a, b, c, d, a, b, c, d, a, b, c, d, a, b, c, d, a, b, c, d);
+            }
+        }
+    }
+}
+
+// Four queues merged by time, one producer round robin over them. inversions counts the lines written before an earlier one.
+void mqmergebench(benchmark::State& state) {
+    using logger_t = common::logger::MultiQueueAsyncLogger<4, msgsize, maxmsgs, common::logger::safetypolicy::Poll>;
+    const std::string filename = "m.log";
+    std::remove(filename.c_str());
+    {
+        common::logger::LoggerManager<logger_t> logger{"mlog", std::string{filename}, 0u};
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            for (int i = 0; i < repeat; i += 4) {
+                logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>, common::logger::QId<0>>(
+                    common::timestamp::MicroSecondTime{}, i, a, b, c, d);
+                logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>, common::logger::QId<1>>(
+                    common::timestamp::MicroSecondTime{}, i + 1, a, b, c, d);
+                logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>, common::logger::QId<2>>(
+                    common::timestamp::MicroSecondTime{}, i + 2, a, b, c, d);
+                logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>, common::logger::QId<3>>(
+                    common::timestamp::MicroSecondTime{}, i + 3, a, b, c, d);
+            }
+        }
+    }
+    std::ifstream is{filename};
+    std::string line;
+    std::getline(is, line);
+    double last = 0;
+    long inversions = 0;
+    while (std::getline(is, line)) {
+        const double tm = std::atof(line.c_str());
+        inversions += tm < last;
+        last = std::max(last, tm);
+    }
+    state.counters["inversions"] = inversions;
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+void mixedspscbench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs>> logger{"xlog", "x.log.backup", "x.log", 0u};
+    mixedsizebench(state, logger);
+}
+
+void mixedvarspscbench(benchmark::State& state) {
+    common::logger::LoggerManager<common::logger::VariableSpscAsyncLogger<msgsize * maxmsgs>> logger{"vlog", "v.log.backup", "v.log", 0u};
+    mixedsizebench(state, logger);
+}
+
+// Lets the benchmark see when the consumer has drained the queue.
+template <typename L>
+class DrainProbe : public L {
+   public:
+    template <typename... Args>
+    DrainProbe(Args&&... args) : L{std::forward<Args>(args)...} {}
+    bool drained() const { return this->queue.empty(); }
+};
+
+static double cputime(clockid_t clk) {
+    timespec ts;
+    clock_gettime(clk, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// One message after the consumer has been idle for a while, timed till it is drained. state.range(0) is microsleep.
+// consumer_cpu is the share of a core the rest of the process (i.e. the consumer) used over the run.
+template <typename WaitPolicy>
+void drainbench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Overwrite, WaitPolicy>;
+    common::logger::LoggerManager<DrainProbe<logger_t>> logger{"dlog", "d.log", static_cast<unsigned int>(state.range(0))};
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    const auto wall0 = std::chrono::steady_clock::now();
+    const auto process0 = cputime(CLOCK_PROCESS_CPUTIME_ID), thread0 = cputime(CLOCK_THREAD_CPUTIME_ID);
+    while (state.KeepRunning()) {
+        a += 1;
+        usleep(200);
+        const auto t0 = std::chrono::steady_clock::now();
+        logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, 1, a, b, c, d);
+        while (!logger.drained()) {
+            // Spin.
+        }
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+    const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    const auto consumer = (cputime(CLOCK_PROCESS_CPUTIME_ID) - process0) - (cputime(CLOCK_THREAD_CPUTIME_ID) - thread0);
+    state.counters["consumer_cpu"] = consumer / wall;
+}
+
+// Loggers are over aligned, plain new doesn't honour that in c++11.
+template <typename T, typename... Args>
+std::unique_ptr<T, void (*)(T*)> makealigned(Args&&... args) {
+    void* mem = nullptr;
+    if (posix_memalign(&mem, alignof(T), sizeof(T)) != 0) {
+        throw std::bad_alloc{};
+    }
+    return {new (mem) T{std::forward<Args>(args)...}, [](T* t) {
+                t->~T();
+                free(t);
+            }};
+}
+
+// The first state.range(0) messages into a freshly constructed 16MB queue, i.e. the page faults the hot thread takes.
+template <typename StoragePolicy>
+void firstnbench(benchmark::State& state) {
+    using options_t = common::logger::options::Options<common::logger::options::Storage<StoragePolicy>>;
+    using logger_t = common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, 256 * 1024, common::logger::safetypolicy::Overwrite,
+                                                                                   common::logger::waitpolicy::Sleep, options_t>>;
+    const int n = state.range(0);
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        auto logger = makealigned<logger_t>("flog", "f.log", 1000u);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            logger->template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a,
+                                                                                                             b, c, d);
+        }
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+}
+
+// spscbench with the queue capacity fixed at compile time vs. given at runtime. Same separately mapped storage for both.
+template <std::size_t qmaxmsgs>
+void capacitybench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, qmaxmsgs, common::logger::safetypolicy::Overwrite, common::logger::waitpolicy::Sleep,
+                                                     common::logger::options::Options<common::logger::options::Storage<common::container::storage::Mapped<0>>>>;
+    common::logger::LoggerManager<logger_t> logger{"clog", "c.log", 0u, static_cast<std::size_t>(msgsize * maxmsgs)};
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    while (state.KeepRunning()) {
+        a += 1;
+        b += 10;
+        d += 0.33;
+        c += 7.01;
+        for (int i = 0; i < repeat; i++) {
+            logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, 1, a, b,
+                                                                                                           c, d);
+        }
+    }
+}
+
+// Text vs. binary sink. Poll makes the producer wait on the consumer, so this is mostly consumer throughput. bytes_per_msg is the file size.
+template <typename logger_t>
+void sinkbench(benchmark::State& state) {
+    const std::string filename = "s.log";
+    std::remove(filename.c_str());
+    {
+        common::logger::LoggerManager<logger_t> logger{"slog", std::string{filename}, 0u};
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            b += 10;
+            d += 0.33;
+            c += 7.01;
+            for (int i = 0; i < repeat; i++) {
+                logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a,
+                                                                                                               b, c, d);
+            }
+        }
+    }
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0) {
+        state.counters["bytes_per_msg"] = static_cast<double>(st.st_size) / (state.iterations() * repeat);
+    }
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+using textsink_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep>;
+using datesink_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep,
+                                                   common::logger::options::Options<common::logger::options::Time<common::logger::TimeFormat::Local>>>;
+using binarysink_t = common::logger::BinarySpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep>;
+
+// Write syscalls and bytes of this process so far, from /proc/self/io.
+static std::pair<std::uint64_t, std::uint64_t> writeSyscalls() {
+    std::ifstream io{"/proc/self/io"};
+    std::string key;
+    std::uint64_t value, syscw = 0, wchar = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            syscw = value;
+        } else if (key == "wchar:") {
+            wchar = value;
+        }
+    }
+    return {syscw, wchar};
+}
+
+// Only Fd takes a buffer size and max delay.
+template <typename L>
+std::unique_ptr<L, void (*)(L*)> makeFileLogger(const std::string& filename, std::size_t buffersize, unsigned int maxdelay, std::true_type) {
+    return makealigned<L>("flog", std::string{filename}, 0u, static_cast<std::size_t>(msgsize * maxmsgs), buffersize, std::size_t{0}, maxdelay);
+}
+template <typename L>
+std::unique_ptr<L, void (*)(L*)> makeFileLogger(const std::string& filename, std::size_t buffersize, unsigned int maxdelay, std::false_type) {
+    return makealigned<L>("flog", std::string{filename}, 0u);
+}
+
+// ofstream vs. LogFile::Fd with a state.range(0) MB buffer, flushed at half of it or after state.range(1) ms, vs. LogFile::Mmap as it comes, vs. LogFile::Lz compressing on the consumer.
+// Poll, so mostly consumer throughput. bytes_per_syscall is over the whole process.
+template <common::logger::LogFile logfile>
+void filebench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep,
+                                                     common::logger::options::Options<common::logger::options::File<logfile>>>;
+    const std::string filename = "f.log";
+    std::remove(filename.c_str());
+    const auto before = writeSyscalls();
+    {
+        const auto manager = makeFileLogger<common::logger::LoggerManager<logger_t>>(
+            filename, static_cast<std::size_t>(state.range(0)) << 20, static_cast<unsigned int>(state.range(1)) * 1000,
+            std::integral_constant<bool, logfile == common::logger::LogFile::Fd>{});
+        auto& logger = *manager;
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            b += 10;
+            d += 0.33;
+            c += 7.01;
+            for (int i = 0; i < repeat; i++) {
+                logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a,
+                                                                                                               b, c, d);
+            }
+        }
+    }
+    const auto after = writeSyscalls();
+    if (after.first > before.first) {
+        state.counters["syscalls"] = after.first - before.first;
+        state.counters["bytes_per_syscall"] = static_cast<double>(after.second - before.second) / (after.first - before.first);
+    }
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// Stream flushed by its due(), every batch, vs. flush policies: 64KB or 10ms, the same and any WARN, and Fd's own threshold for comparison.
+// Poll and no sleep, so batches are small. One record in 1000 is a WARN. flushes and by_* are run()'s, see flushpolicy::Stats.
+template <common::logger::LogFile logfile, typename FlushPolicy>
+void flushbench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep,
+                                                     common::logger::options::Options<common::logger::options::File<logfile>, common::logger::options::Flush<FlushPolicy>>>;
+    const std::string filename = "f.log";
+    std::remove(filename.c_str());
+    const auto before = writeSyscalls();
+    common::logger::flushpolicy::Stats stats{};
+    {
+        common::logger::LoggerManager<logger_t> logger{"flog", std::string{filename}, 0u};
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            b += 10;
+            d += 0.33;
+            c += 7.01;
+            for (int i = 0; i < repeat; i++) {
+                if (i % 1000 == 0) {
+                    logger.template log<common::logger::label::LabelList<common::logger::level::WARN, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a);
+                } else {
+                    logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i,
+                                                                                                                   a, b, c, d);
+                }
+            }
+        }
+        stats = logger.getFlushStats();
+    }
+    const auto after = writeSyscalls();
+    state.counters["syscalls"] = after.first - before.first;
+    state.counters["flushes"] = stats.flushes;
+    state.counters["by_size"] = stats.bySize;
+    state.counters["by_age"] = stats.byAge;
+    state.counters["by_severity"] = stats.bySeverity;
+    state.SetItemsProcessed(state.iterations() * repeat);
+    std::remove(filename.c_str());
+}
+using sizeorage_t = common::logger::flushpolicy::Any<common::logger::flushpolicy::Bytes<64 << 10>, common::logger::flushpolicy::Age<10000>>;
+using sizeageorwarn_t = common::logger::flushpolicy::Any<common::logger::flushpolicy::Bytes<64 << 10>, common::logger::flushpolicy::Age<10000>,
+                                                         common::logger::flushpolicy::Severity<common::logger::level::WARN>>;
+
+// Slow storage stand-in: a fifo whose reader stalls for stallms every stallevery bytes, like a disk during journal commits.
+class SlowReader {
+   private:
+    const std::string path;
+    std::thread reader;
+
+   public:
+    SlowReader(std::string path_, std::size_t stallevery, unsigned stallms) : path{std::move(path_)} {
+        std::remove(this->path.c_str());
+        if (mkfifo(this->path.c_str(), 0644) != 0) {
+            throw std::runtime_error{"mkfifo"};
+        }
+        this->reader = std::thread{[this, stallevery, stallms]() {
+            const int fd = open(this->path.c_str(), O_RDONLY);
+            std::unique_ptr<char[]> buf{new char[1 << 16]};
+            std::size_t sincestall = 0;
+            ssize_t got;
+            while ((got = read(fd, buf.get(), 1 << 16)) > 0) {
+                sincestall += got;
+                if (sincestall >= stallevery) {
+                    sincestall = 0;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(stallms));
+                }
+            }
+            close(fd);
+        }};
+    }
+    // After the writer closed its end.
+    ~SlowReader() {
+        this->reader.join();
+        std::remove(this->path.c_str());
+    }
+};
+
+// Fd (write(2) from the consumer) vs. Uring, into SlowReader stalling state.range(0) ms every 256KB. Poll, so a stalled consumer stalls the producer.
+// max_stall_ms is the longest any 1000 consecutive log calls took.
+template <common::logger::LogFile logfile>
+void slowsinkbench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep,
+                                                     common::logger::options::Options<common::logger::options::File<logfile>>>;
+    SlowReader reader{"slow.fifo", 256 << 10, static_cast<unsigned>(state.range(0))};
+    double maxstall = 0;
+    {
+        common::logger::LoggerManager<logger_t> logger{"slog", std::string{"slow.fifo"}, 0u, static_cast<std::size_t>(msgsize * maxmsgs)};
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            b += 10;
+            d += 0.33;
+            c += 7.01;
+            for (int i = 0; i < repeat; i += 1000) {
+                const auto t0 = std::chrono::steady_clock::now();
+                for (int j = i; j < i + 1000; j++) {
+                    logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{},
+                                                                                                                   j, a, b, c, d);
+                }
+                maxstall = std::max(maxstall, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            }
+        }
+    }
+    state.counters["max_stall_ms"] = maxstall;
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// Pages of the file in the page cache, in MB.
+static double cachedMB(const std::string& filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    const std::size_t pagesize = sysconf(_SC_PAGESIZE);
+    const std::size_t pages = (st.st_size + pagesize - 1) / pagesize;
+    void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return 0;
+    }
+    std::vector<unsigned char> resident(pages);
+    std::size_t count = 0;
+    if (mincore(mem, st.st_size, resident.data()) == 0) {
+        count = std::count_if(resident.begin(), resident.end(), [](unsigned char c) { return c & 1; });
+    }
+    munmap(mem, st.st_size);
+    return static_cast<double>(count * pagesize) / (1 << 20);
+}
+
+// Just the file end of a logger, written the way AsyncLogger::run does: a batch, then flush() if due().
+template <common::logger::LogFile logfile>
+struct FileWriter : common::logger::Logger<logfile> {
+    template <typename... Args>
+    explicit FileWriter(std::string&& filename, Args&&... args) : common::logger::Logger<logfile>{std::move(filename), std::forward<Args>(args)...} {}
+    void batch(const char* data, std::size_t length) {
+        this->file.write(data, length);
+        if (this->due()) {
+            this->flush();
+        }
+    }
+};
+
+// Log lines, whole ones, up to about batchsize bytes.
+static std::string linebatch(std::size_t batchsize) {
+    std::string batch;
+    for (int i = 0; batch.size() + 64 < batchsize; i++) {
+        batch += std::to_string(1700000000 + i) + ".123456,INF,TAG," + std::to_string(i) + ",2,3.5,1.22\n";
+    }
+    return batch;
+}
+
+// batches times batch into writer, the time of each in microseconds onto latencies.
+template <typename W>
+static void timebatches(W& writer, const std::string& batch, std::size_t batches, std::vector<double>& latencies) {
+    for (std::size_t i = 0; i < batches; i++) {
+        const auto t0 = std::chrono::steady_clock::now();
+        writer.batch(batch.data(), batch.size());
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+}
+
+// p50, p99, p999 and max of latencies as counters, unit their suffix.
+static void percentiles(benchmark::State& state, std::vector<double>& latencies, const std::string& unit) {
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double p) { return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))]; };
+    state.counters["p50_" + unit] = percentile(0.5);
+    state.counters["p99_" + unit] = percentile(0.99);
+    state.counters["p999_" + unit] = percentile(0.999);
+    state.counters["max_" + unit] = latencies.back();
+}
+
+// Page cache vs. O_DIRECT vs. mmap vs. compressed: 256MB in 64KB batches. cached_mb is what the file leaves in the page cache, p50/p99/p999/max_us the time per batch.
+template <common::logger::LogFile logfile>
+void directbench(benchmark::State& state) {
+    const std::string filename = "d.log";
+    static constexpr std::size_t batches = 4096;
+    const std::string batch = linebatch(64 << 10);
+    std::vector<double> latencies;
+    double cached = 0;
+    while (state.KeepRunning()) {
+        std::remove(filename.c_str());
+        {
+            FileWriter<logfile> writer{std::string{filename}};
+            timebatches(writer, batch, batches, latencies);
+        }
+        cached = cachedMB(filename);
+    }
+    state.counters["cached_mb"] = cached;
+    percentiles(state, latencies, "us");
+    state.SetBytesProcessed(state.iterations() * batches * batch.size());
+    std::remove(filename.c_str());
+}
+
+// LogFile::Rotate into a new file every state.range(0) MB, 0 never: 256MB in 64KB batches as in directbench, p50/p99/p999/max_us the time per batch.
+// A rotation is a batch like any other, the renames and the next file are on the rotator thread. late counts rotations put off for it.
+void rotatebench(benchmark::State& state) {
+    const std::string filename = "r.log";
+    static constexpr std::size_t batches = 4096;
+    const std::string batch = linebatch(64 << 10);
+    const auto removeAll = [&filename]() {
+        glob_t found;
+        if (glob((filename + "*").c_str(), 0, nullptr, &found) == 0) {
+            for (std::size_t i = 0; i < found.gl_pathc; i++) {
+                std::remove(found.gl_pathv[i]);
+            }
+        }
+        globfree(&found);
+    };
+    std::vector<double> latencies;
+    common::logger::RotatingBuffer::Stats stats{};
+    while (state.KeepRunning()) {
+        removeAll();
+        FileWriter<common::logger::LogFile::Rotate> writer{std::string{filename}, static_cast<std::uint64_t>(state.range(0)) << 20};
+        timebatches(writer, batch, batches, latencies);
+        writer.flush();
+        stats = writer.getStats();
+    }
+    removeAll();
+    state.counters["rotations"] = stats.rotations;
+    state.counters["late"] = stats.late;
+    percentiles(state, latencies, "us");
+    state.SetBytesProcessed(state.iterations() * batches * batch.size());
+}
+
+// LogFile::Lz's compression alone, state.range(0) 0 compress, 1 decompress: 1MB blocks of log lines as the text loggers write them, a few tags
+// and levels, prices and quantities that wander. cpu_ms_per_mb is the consumer's cost per MB of text, ratio text over frames.
+void lzbench(benchmark::State& state) {
+    using namespace common::logger;
+    static constexpr std::size_t blocksize = Logger<LogFile::Lz>::defaultBlockSize;
+    static const char* const tags[] = {"ORDER", "FILL", "CANCEL", "QUOTE"};
+    static const char* const levels[] = {"[INFO]", "[WARN]", "[DEBUG]"};
+    std::mt19937 rng{42};
+    std::string text;
+    long micros = 1700000000000000;
+    double price = 101.25;
+    while (text.size() < blocksize) {
+        micros += rng() % 50;
+        price += (static_cast<int>(rng() % 5) - 2) * 0.25;
+        text += std::to_string(micros / 1000000) + '.' + std::to_string(1000000 + micros % 1000000).substr(1) + ',' + levels[rng() % 3] + ',' + tags[rng() % 4] +
+                ',' + std::to_string(rng() % 100000) + ',' + std::to_string(price) + ',' + std::to_string(rng() % 1000) + '\n';
+    }
+    text.resize(blocksize);
+    std::unique_ptr<char[]> compressed{new char[lz::maxCompressedSize(blocksize)]};
+    std::unique_ptr<char[]> raw{new char[blocksize]};
+    std::unique_ptr<std::uint32_t[]> table{new std::uint32_t[lz::hashSize]};
+    const auto size = lz::compress(text.data(), text.size(), compressed.get(), table.get());
+    const auto start = std::clock();
+    while (state.KeepRunning()) {
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(lz::compress(text.data(), text.size(), compressed.get(), table.get()));
+        } else {
+            lz::decompress(compressed.get(), size, raw.get(), blocksize);
+            benchmark::DoNotOptimize(raw.get());
+        }
+    }
+    const double mb = static_cast<double>(state.iterations()) * blocksize / (1 << 20);
+    state.counters["cpu_ms_per_mb"] = (std::clock() - start) * 1000.0 / CLOCKS_PER_SEC / mb;
+    state.counters["ratio"] = static_cast<double>(blocksize) / size;
+    state.SetBytesProcessed(state.iterations() * blocksize);
+}
+
+// Online cpus this process may run on.
+std::vector<int> allowedcpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// A line of the cpu's sysfs topology, eg. "physical_package_id", empty if there's none.
+std::string topology(int cpu, const char* what) {
+    std::ifstream is{"/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + what};
+    std::string line;
+    std::getline(is, line);
+    return line;
+}
+
+// Whether cpu is in a list like "0-3,8".
+bool inlist(const std::string& list, int cpu) {
+    int first = 0, last = 0;
+    const char* at = list.c_str();
+    while (*at) {
+        int n = 0;
+        if (std::sscanf(at, "%d-%d%n", &first, &last, &n) != 2) {
+            if (std::sscanf(at, "%d%n", &first, &n) != 1) {
+                return false;
+            }
+            last = first;
+        }
+        if (first <= cpu && cpu <= last) {
+            return true;
+        }
+        at += n;
+        at += *at == ',';
+    }
+    return false;
+}
+
+// The consumer's cpu for a producer on cpu: 0 the same, 1 its hyperthread sibling, 2 another core of its socket, 3 another socket. -1 if none.
+int consumercpu(int cpu, int placement) {
+    if (placement == 0) {
+        return cpu;
+    }
+    const auto siblings = topology(cpu, "thread_siblings_list");
+    const auto package = topology(cpu, "physical_package_id");
+    for (const int other : allowedcpus()) {
+        if (other == cpu) {
+            continue;
+        }
+        const bool sibling = inlist(siblings, other), samepackage = topology(other, "physical_package_id") == package;
+        if ((placement == 1 && sibling) || (placement == 2 && !sibling && samepackage) || (placement == 3 && !samepackage)) {
+            return other;
+        }
+    }
+    return -1;
+}
+
+// Producer pinned to the first allowed cpu, the consumer through ThreadOptions to the cpu state.range(0) places it on, see consumercpu.
+// Skipped where the machine has no such cpu. p50/p99/p999/max_ns the time per log call, which is where the consumer sharing the queue's
+// cachelines, or the core, shows.
+void placementbench(benchmark::State& state) {
+    using logger_t = common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll, common::logger::waitpolicy::Sleep>;
+    const auto cpus = allowedcpus();
+    const int producer = cpus.empty() ? -1 : cpus.front();
+    const int consumer = producer < 0 ? -1 : consumercpu(producer, state.range(0));
+    if (consumer < 0) {
+        state.SkipWithError("No cpu for this placement");
+        return;
+    }
+    cpu_set_t previous, pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(producer, &pinned);
+    pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous);
+    pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+    std::vector<double> latencies;
+    latencies.reserve(1 << 20);
+    {
+        common::logger::LoggerManager<logger_t> logger{common::logger::ThreadOptions{}.affinity({consumer}), "plog", "p.log", 0u};
+        int a = 2, b = 5;
+        double c = 5.0, d = 1.22;
+        while (state.KeepRunning()) {
+            a += 1;
+            for (int i = 0; i < 1000; i++) {
+                const auto t0 = std::chrono::steady_clock::now();
+                logger.template log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a,
+                                                                                                               b, c, d);
+                const auto t1 = std::chrono::steady_clock::now();
+                if (latencies.size() < latencies.capacity()) {
+                    latencies.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+                }
+            }
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+    state.counters["producer_cpu"] = producer;
+    state.counters["consumer_cpu"] = consumer;
+    percentiles(state, latencies, "ns");
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+// state.range(0) loggers, with a consumer thread each if state.range(1) is 0, otherwise sharing that many Executor threads, third arg 1
+// for Order::Fill. One producer round robin over them, every tenth log call to the first logger, the rest spread over the others.
+// consumer_cpu as in drainbench.
+void executorbench(benchmark::State& state) {
+    using logger_t = common::logger::LoggerManager<common::logger::SpscAsyncLogger<msgsize, maxmsgs, common::logger::safetypolicy::Poll>>;
+    using executor_t = common::logger::Executor<>;
+    const auto loggers = static_cast<std::size_t>(state.range(0)), threads = static_cast<std::size_t>(state.range(1));
+    const auto order = state.range(2) ? common::logger::executor::Order::Fill : common::logger::executor::Order::RoundRobin;
+    auto executor = threads ? makealigned<executor_t>("xlog", threads, order, 100u) : std::unique_ptr<executor_t, void (*)(executor_t*)>{nullptr, nullptr};
+    std::vector<std::unique_ptr<logger_t, void (*)(logger_t*)>> all;
+    for (std::size_t i = 0; i < loggers; i++) {
+        const auto filename = "x" + std::to_string(i) + ".log";
+        std::remove(filename.c_str());
+        all.push_back(executor ? makealigned<logger_t>(*executor, std::string{filename}, 100u) : makealigned<logger_t>("xlog", std::string{filename}, 100u));
+    }
+    int a = 2, b = 5;
+    double c = 5.0, d = 1.22;
+    const auto wall0 = std::chrono::steady_clock::now();
+    const auto process0 = cputime(CLOCK_PROCESS_CPUTIME_ID), thread0 = cputime(CLOCK_THREAD_CPUTIME_ID);
+    while (state.KeepRunning()) {
+        a += 1;
+        for (int i = 0; i < repeat; i++) {
+            auto& logger = *all[i % 10 == 0 || loggers == 1 ? 0 : 1 + i % (loggers - 1)];
+            logger.log<common::logger::label::LabelList<common::logger::level::INFO, SCT("TAG")>>(common::timestamp::MicroSecondTime{}, i, a, b, c, d);
+        }
+    }
+    const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    const auto consumer = (cputime(CLOCK_PROCESS_CPUTIME_ID) - process0) - (cputime(CLOCK_THREAD_CPUTIME_ID) - thread0);
+    all.clear();
+    state.counters["consumer_cpu"] = consumer / wall;
+    state.counters["consumer_threads"] = threads ? threads : loggers;
+    state.SetItemsProcessed(state.iterations() * repeat);
+}
+
+// Consumer side only: messages of four types interleaved in a buffer, dispatched and written to a stream that discards them.
+void consumerbench(benchmark::State& state) {
+    using namespace common::logger;
+    using timed_t = TimedFormattedMessage<',', '\n', label::LabelList<level::INFO, SCT("TAG")>, common::timestamp::MicroSecondTime, int, int, double>;
+    using labelled_t = TimedFormattedMessage<',', '\n', label::LabelList<level::WARN, SCT("TAG")>, void, int, double>;
+    using raw_t = FormattedMessage<',', '\n', int, int>;
+    using chunk_t = FormattedMessage<',', '\n', double>;
+    static constexpr std::size_t count = 4096;
+    std::unique_ptr<char[]> buf{new char[count * msgsize + 64]};
+    char* const slots = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(buf.get()) + 63) & ~std::uintptr_t{63});
+    for (std::size_t i = 0; i < count; i++) {
+        char* at = slots + i * msgsize;
+        switch (i % 4) {
+            case 0: new (at) timed_t{common::timestamp::MicroSecondTime{}, int(i), 2, 1.5}; break;
+            case 1: new (at) labelled_t{int(i), 2.5}; break;
+            case 2: new (at) raw_t{int(i), 7}; break;
+            default: new (at) chunk_t{0.25};
+        }
+    }
+    std::ofstream os{"/dev/null"};
+    text::Writer out{os};
+    common::timestamp::MicroSecondTime lastTime{};
+    while (state.KeepRunning()) {
+        for (std::size_t i = 0; i < count; i++) {
+            const auto msg = reinterpret_cast<const Message*>(slots + i * msgsize);
+            const auto& info = msg->getInfo();
+            if (info.isTimed) {
+                if (info.hasTime) {
+                    lastTime = *(static_cast<const common::timestamp::MicroSecondTime*>(msg->getTime()));
+                } else {
+                    out.write(lastTime);
+                }
+            }
+            msg->write(out);
+        }
+        out.drain();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Times as the consumer writes them, cached is the Writer's: seconds rendered once per second, only the micros per line. Otherwise all of it
+// per line, as before: itoa for Epoch, localtime_r and strftime for the dates. Records 3us apart.
+template <common::logger::TimeFormat timeformat, bool cached>
+void timeformatbench(benchmark::State& state) {
+    using namespace common::logger;
+    static constexpr std::size_t count = 4096;
+    std::vector<common::timestamp::MicroSecondTime> times;
+    const long start = common::timestamp::MicroSecondTime{}.getIntegral();
+    for (std::size_t i = 0; i < count; i++) {
+        times.emplace_back(start + static_cast<long>(i) * 3);
+    }
+    std::ofstream os{"/dev/null"};
+    text::Writer out{os, timeformat};
+    long offset = 0;
+    while (state.KeepRunning()) {
+        for (const auto& t : times) {
+            const common::timestamp::MicroSecondTime now{t.getIntegral() + offset};
+            if (cached) {
+                out.write(now);
+            } else {
+                out.reserve(text::codec<common::timestamp::MicroSecondTime>::maxLength);
+                if (timeformat == TimeFormat::Epoch) {
+                    text::detail::writeInteger(out, now.getSeconds(), ' ', 0);
+                } else {
+                    const std::time_t seconds = now.getSeconds();
+                    struct tm tm;
+                    timeformat == TimeFormat::Local ? localtime_r(&seconds, &tm) : gmtime_r(&seconds, &tm);
+                    out.advance(std::strftime(out.cursor(), out.room(), "%Y-%m-%d %H:%M:%S", &tm));
+                }
+                out.put('.');
+                text::detail::writeInteger(out, now.getMicroSeconds(), '0', 6);
+            }
+            out.put('\n');
+        }
+        offset += count * 3;
+    }
+    out.drain();
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
 void copybench(benchmark::State& state) {
     // common::timestamp::MicroSecondTime x{};
     std::ofstream os{"dummy.log", std::ios::out | std::ios::app};
@@ -80,7 +967,51 @@ void copybench(benchmark::State& state) {
 }
 
 BENCHMARK(spscbench)->Range(8, 8 << 10)->UseRealTime();
+BENCHMARK(spscbatchbench)->Arg(1)->Arg(5)->Arg(20)->UseRealTime();
+BENCHMARK_TEMPLATE(timebench, common::timestamp::MicroSecondTime)->UseRealTime();
+BENCHMARK_TEMPLATE(timebench, common::timestamp::TscTime)->UseRealTime();
+BENCHMARK(stringbench)->Arg(8)->Arg(40)->Arg(200)->UseRealTime();
+BENCHMARK_TEMPLATE(formatbench, false)->UseRealTime();
+BENCHMARK_TEMPLATE(formatbench, true)->UseRealTime();
+BENCHMARK(mpscbench)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+BENCHMARK(perthreadbench)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
 BENCHMARK(mqscbench)->Range(8, 8 << 10)->UseRealTime();
+BENCHMARK(mqmergebench)->UseRealTime();
+BENCHMARK(mixedspscbench)->UseRealTime();
+BENCHMARK(mixedvarspscbench)->UseRealTime();
+BENCHMARK_TEMPLATE(drainbench, common::logger::waitpolicy::Sleep)->Arg(0)->Arg(50)->UseManualTime();
+BENCHMARK_TEMPLATE(drainbench, common::logger::waitpolicy::Backoff<>)->Arg(0)->UseManualTime();
+BENCHMARK_TEMPLATE(firstnbench, common::container::storage::Inline)->Range(1 << 10, 1 << 16)->UseManualTime();
+BENCHMARK_TEMPLATE(firstnbench, common::container::storage::Mapped<>)->Range(1 << 10, 1 << 16)->UseManualTime();
+BENCHMARK_TEMPLATE(capacitybench, maxmsgs)->UseRealTime();
+BENCHMARK_TEMPLATE(capacitybench, common::container::dynamicSize)->UseRealTime();
+BENCHMARK_TEMPLATE(sinkbench, textsink_t)->UseRealTime();
+BENCHMARK_TEMPLATE(sinkbench, datesink_t)->UseRealTime();
+BENCHMARK_TEMPLATE(sinkbench, binarysink_t)->UseRealTime();
+BENCHMARK_TEMPLATE(filebench, common::logger::LogFile::Stream)->Args({0, 0})->UseRealTime();
+BENCHMARK_TEMPLATE(filebench, common::logger::LogFile::Fd)->Args({1, 1})->Args({1, 100})->Args({8, 100})->UseRealTime();
+BENCHMARK_TEMPLATE(filebench, common::logger::LogFile::Mmap)->Args({0, 0})->UseRealTime();
+BENCHMARK_TEMPLATE(filebench, common::logger::LogFile::Lz)->Args({0, 0})->UseRealTime();
+BENCHMARK_TEMPLATE(flushbench, common::logger::LogFile::Stream, common::logger::flushpolicy::Logfile)->UseRealTime();
+BENCHMARK_TEMPLATE(flushbench, common::logger::LogFile::Stream, sizeorage_t)->UseRealTime();
+BENCHMARK_TEMPLATE(flushbench, common::logger::LogFile::Stream, sizeageorwarn_t)->UseRealTime();
+BENCHMARK_TEMPLATE(flushbench, common::logger::LogFile::Fd, common::logger::flushpolicy::Logfile)->UseRealTime();
+BENCHMARK_TEMPLATE(slowsinkbench, common::logger::LogFile::Fd)->Arg(0)->Arg(100)->UseRealTime();
+BENCHMARK_TEMPLATE(slowsinkbench, common::logger::LogFile::Uring)->Arg(0)->Arg(100)->UseRealTime();
+BENCHMARK_TEMPLATE(directbench, common::logger::LogFile::Fd)->UseRealTime();
+BENCHMARK_TEMPLATE(directbench, common::logger::LogFile::Direct)->UseRealTime();
+BENCHMARK_TEMPLATE(directbench, common::logger::LogFile::Mmap)->UseRealTime();
+BENCHMARK_TEMPLATE(directbench, common::logger::LogFile::Lz)->UseRealTime();
+BENCHMARK(lzbench)->Arg(0)->Arg(1);
+BENCHMARK(rotatebench)->Arg(0)->Arg(4)->Arg(32)->UseRealTime();
+BENCHMARK(placementbench)->Arg(0)->Arg(1)->Arg(2)->Arg(3)->UseRealTime();
+BENCHMARK(executorbench)->Args({12, 0, 0})->Args({12, 1, 0})->Args({12, 1, 1})->Args({12, 2, 0})->UseRealTime();
+BENCHMARK(consumerbench);
+BENCHMARK_TEMPLATE(timeformatbench, common::logger::TimeFormat::Epoch, false);
+BENCHMARK_TEMPLATE(timeformatbench, common::logger::TimeFormat::Epoch, true);
+BENCHMARK_TEMPLATE(timeformatbench, common::logger::TimeFormat::Local, false);
+BENCHMARK_TEMPLATE(timeformatbench, common::logger::TimeFormat::Local, true);
+BENCHMARK_TEMPLATE(timeformatbench, common::logger::TimeFormat::Utc, true);
 BENCHMARK(copybench)->Range(8, 8 << 10)->UseRealTime();
 
 int main(int argc, char** argv) {
@@ -0,0 +1,60 @@
+#ifndef _DECODE_MAIN_HPP_
+#define _DECODE_MAIN_HPP_
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace common {
+namespace logger {
+// main of the tools: tool [input [output]], stdin/stdout otherwise. Input is read in chunks and handed to decoder.decode(data, length, out),
+// which returns the bytes it used, 0 while it needs more. unit is what it decodes one at a time, for the error on trailing bytes.
+template <typename Decoder>
+int decodeMain(int argc, char **argv, const char *tool, const char *unit, Decoder &decoder) {
+    std::ifstream infile;
+    std::ofstream outfile;
+    if (argc > 1) {
+        infile.open(argv[1], std::ios::in | std::ios::binary);
+        if (!infile) {
+            std::cerr << tool << ": can't open " << argv[1] << '\n';
+            return 1;
+        }
+    }
+    if (argc > 2) {
+        outfile.open(argv[2], std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!outfile) {
+            std::cerr << tool << ": can't open " << argv[2] << '\n';
+            return 1;
+        }
+    }
+    std::istream &in = argc > 1 ? static_cast<std::istream &>(infile) : std::cin;
+    std::ostream &out = argc > 2 ? static_cast<std::ostream &>(outfile) : std::cout;
+
+    std::vector<char> buffer;
+    std::size_t begin = 0;
+    std::vector<char> chunk(1 << 20);
+    try {
+        while (in) {
+            in.read(chunk.data(), chunk.size());
+            buffer.erase(buffer.begin(), buffer.begin() + begin);
+            buffer.insert(buffer.end(), chunk.data(), chunk.data() + in.gcount());
+            begin = 0;
+            while (const auto used = decoder.decode(buffer.data() + begin, buffer.size() - begin, out)) {
+                begin += used;
+            }
+        }
+    } catch (const std::exception &e) {
+        out.flush();
+        std::cerr << tool << ": " << e.what() << '\n';
+        return 1;
+    }
+    if (begin != buffer.size()) {
+        std::cerr << tool << ": " << buffer.size() - begin << " trailing bytes, truncated " << unit << '\n';
+        return 1;
+    }
+    return 0;
+}
+}    // logger end
+}    // common end
+#endif
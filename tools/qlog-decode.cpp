@@ -0,0 +1,9 @@
+// Renders a log written by BinarySpscAsyncLogger back to the csv the text loggers write.
+// qlog-decode [binary log [output]], stdin/stdout otherwise.
+#include "BinaryFormat.hpp"
+#include "DecodeMain.hpp"
+
+int main(int argc, char **argv) {
+    common::logger::binary::Decoder decoder;
+    return common::logger::decodeMain(argc, argv, "qlog-decode", "record", decoder);
+}
@@ -0,0 +1,9 @@
+// Decompresses a log written with LogFile::Lz back to its text, frame by frame as they are read. Binary logs then go through qlog-decode.
+// qlog-unlz [compressed log [output]], stdin/stdout otherwise.
+#include "DecodeMain.hpp"
+#include "LzFormat.hpp"
+
+int main(int argc, char **argv) {
+    common::logger::lz::FrameReader reader;
+    return common::logger::decodeMain(argc, argv, "qlog-unlz", "frame", reader);
+}